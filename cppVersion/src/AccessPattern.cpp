@@ -0,0 +1,139 @@
+#include "AccessPattern.h"
+#include <random>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+// FNV-1a over the rank, so the hottest Zipf ranks land all over the file
+// instead of all at the front (YCSB's ScrambledZipfian does the same)
+uint64_t scramble(uint64_t v) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (int i = 0; i < 8; ++i) {
+        h ^= (v >> (i * 8)) & 0xFF;
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+// Gray et al. "Quickly generating billion-record synthetic databases",
+// the same generator YCSB uses. zeta(n) is O(n) but only computed once.
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double theta) : n(n), theta(theta) {
+        double zeta2 = 1.0 + std::pow(0.5, theta);
+        zetan = 0.0;
+        for (size_t i = 1; i <= n; ++i) zetan += 1.0 / std::pow(static_cast<double>(i), theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+    
+    size_t next(std::mt19937& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        size_t rank = static_cast<size_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+        return std::min(rank, n - 1);
+    }
+    
+private:
+    size_t n;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+}
+
+AccessPattern::AccessPattern(unsigned int seed) : AccessPattern(seed, Options()) {}
+
+AccessPattern::AccessPattern(unsigned int seed, const Options& options)
+    : seed(seed), options(options) {
+    if (options.zipfTheta <= 0.0 || options.zipfTheta >= 1.0)
+        throw std::invalid_argument("zipfTheta must be in (0, 1)");
+    if (options.hotSetFraction <= 0.0 || options.hotSetFraction > 1.0)
+        throw std::invalid_argument("hotSetFraction must be in (0, 1]");
+}
+
+std::string AccessPattern::name(Distribution dist) {
+    switch (dist) {
+    case Distribution::Uniform:          return "uniform";
+    case Distribution::Zipfian:          return "zipfian";
+    case Distribution::Hotspot:          return "hotspot";
+    case Distribution::SequentialRuns:   return "seq-runs";
+    case Distribution::TemporalLocality: return "temporal";
+    }
+    return "unknown";
+}
+
+std::vector<Distribution> AccessPattern::all() {
+    return {Distribution::Uniform, Distribution::Zipfian, Distribution::Hotspot,
+            Distribution::SequentialRuns, Distribution::TemporalLocality};
+}
+
+std::vector<int> AccessPattern::generate(Distribution dist, size_t count, size_t numRecords) const {
+    if (numRecords == 0) throw std::invalid_argument("no records to read");
+    
+    std::vector<int> indices;
+    indices.reserve(count);
+    
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> any(0, static_cast<int>(numRecords - 1));
+    
+    switch (dist) {
+    case Distribution::Uniform:
+        // same draws as the old generateRandomIndices, so old numbers still compare
+        for (size_t i = 0; i < count; ++i) indices.push_back(any(rng));
+        break;
+    
+    case Distribution::Zipfian: {
+        ZipfGenerator zipf(numRecords, options.zipfTheta);
+        for (size_t i = 0; i < count; ++i) {
+            indices.push_back(static_cast<int>(scramble(zipf.next(rng)) % numRecords));
+        }
+        break;
+    }
+    
+    case Distribution::Hotspot: {
+        // hot set is one contiguous range starting somewhere random, like a
+        // recent run that everyone is looking at
+        size_t hotSize = std::max<size_t>(1, static_cast<size_t>(numRecords * options.hotSetFraction));
+        size_t hotStart = std::uniform_int_distribution<size_t>(0, numRecords - hotSize)(rng);
+        std::uniform_int_distribution<size_t> hot(0, hotSize - 1);
+        std::bernoulli_distribution isHot(options.hotOpFraction);
+        for (size_t i = 0; i < count; ++i) {
+            indices.push_back(isHot(rng) ? static_cast<int>(hotStart + hot(rng)) : any(rng));
+        }
+        break;
+    }
+    
+    case Distribution::SequentialRuns: {
+        std::geometric_distribution<size_t> runLength(1.0 / (1.0 + options.meanRunLength));
+        while (indices.size() < count) {
+            size_t start = static_cast<size_t>(any(rng));
+            size_t len = std::max<size_t>(1, runLength(rng));
+            for (size_t j = 0; j < len && indices.size() < count; ++j) {
+                indices.push_back(static_cast<int>((start + j) % numRecords));
+            }
+        }
+        break;
+    }
+    
+    case Distribution::TemporalLocality: {
+        std::bernoulli_distribution reuse(options.reuseProbability);
+        for (size_t i = 0; i < count; ++i) {
+            if (!indices.empty() && reuse(rng)) {
+                size_t window = std::min(options.reuseWindow, indices.size());
+                size_t back = std::uniform_int_distribution<size_t>(1, window)(rng);
+                indices.push_back(indices[indices.size() - back]);
+            } else {
+                indices.push_back(any(rng));
+            }
+        }
+        break;
+    }
+    }
+    
+    return indices;
+}
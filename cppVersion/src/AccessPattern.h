@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+enum class Distribution {
+    Uniform,            // every record equally likely
+    Zipfian,            // YCSB-style power law over scrambled ranks
+    Hotspot,            // hotOpFraction of reads go to hotSetFraction of records
+    SequentialRuns,     // short forward scans, then a jump somewhere random
+    TemporalLocality    // mostly re-reads of something read recently
+};
+
+// Read index streams for the random read phases. Like DataGenerator every
+// stream is fixed by the seed - each generate() call starts from the seed,
+// so the same (distribution, count, numRecords) always gives the same
+// indices no matter what was generated before it.
+class AccessPattern {
+public:
+    struct Options {
+        double zipfTheta = 0.99;        // YCSB default skew
+        double hotSetFraction = 0.2;
+        double hotOpFraction = 0.8;
+        size_t meanRunLength = 32;      // records per sequential run
+        double reuseProbability = 0.7;  // temporal: chance of re-reading
+        size_t reuseWindow = 1024;      // ... one of the last this-many reads
+    };
+    
+    AccessPattern(unsigned int seed = 24);
+    AccessPattern(unsigned int seed, const Options& options);
+    
+    std::vector<int> generate(Distribution dist, size_t count, size_t numRecords) const;
+    
+    static std::string name(Distribution dist);
+    static std::vector<Distribution> all();
+    
+private:
+    unsigned int seed;
+    Options options;
+};
@@ -0,0 +1,78 @@
+#include "AlignedBuffer.h"
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace {
+char* allocAligned(size_t size) {
+#ifdef _WIN32
+    void* p = _aligned_malloc(size, AlignedBuffer::alignment);
+    if (!p) throw std::bad_alloc();
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, AlignedBuffer::alignment, size) != 0) throw std::bad_alloc();
+#endif
+    return static_cast<char*>(p);
+}
+
+void freeAligned(char* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+}
+
+AlignedBuffer::AlignedBuffer(size_t capacity) {
+    reserve(capacity);
+}
+
+AlignedBuffer::~AlignedBuffer() {
+    if (ptr) freeAligned(ptr);
+}
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer&& other) noexcept
+    : ptr(std::exchange(other.ptr, nullptr)), cap(std::exchange(other.cap, 0)) {}
+
+AlignedBuffer& AlignedBuffer::operator=(AlignedBuffer&& other) noexcept {
+    if (this != &other) {
+        if (ptr) freeAligned(ptr);
+        ptr = std::exchange(other.ptr, nullptr);
+        cap = std::exchange(other.cap, 0);
+    }
+    return *this;
+}
+
+void AlignedBuffer::reserve(size_t n) {
+    if (n <= cap) return;
+    size_t newCap = alignUp(n);
+    char* p = allocAligned(newCap);
+    if (ptr) freeAligned(ptr);
+    ptr = p;
+    cap = newCap;
+}
+
+AlignedBufferPool::Lease AlignedBufferPool::acquire(size_t minSize) {
+    std::unique_ptr<AlignedBuffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!idle.empty()) {
+            buffer = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    if (!buffer) buffer = std::make_unique<AlignedBuffer>(bufferSize);
+    buffer->reserve(minSize);
+    return Lease(this, std::move(buffer));
+}
+
+void AlignedBufferPool::release(std::unique_ptr<AlignedBuffer> buffer) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (idle.size() < maxIdle) idle.push_back(std::move(buffer));
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+
+// Heap buffer whose address (and capacity) is aligned for O_DIRECT.
+class AlignedBuffer {
+public:
+    // 4KB covers the logical block size of everything we run on
+    static constexpr size_t alignment = 4096;
+    
+    explicit AlignedBuffer(size_t capacity = 0);
+    ~AlignedBuffer();
+    
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+    AlignedBuffer(AlignedBuffer&& other) noexcept;
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept;
+    
+    // grows to at least n bytes (rounded up to the alignment). Contents are
+    // not preserved when it has to reallocate.
+    void reserve(size_t n);
+    
+    char* data() { return ptr; }
+    const char* data() const { return ptr; }
+    size_t capacity() const { return cap; }
+    
+private:
+    char* ptr = nullptr;
+    size_t cap = 0;
+};
+
+inline size_t alignUp(size_t n, size_t a = AlignedBuffer::alignment) {
+    return (n + a - 1) / a * a;
+}
+
+inline size_t alignDown(size_t n, size_t a = AlignedBuffer::alignment) {
+    return n / a * a;
+}
+
+// Keeps aligned buffers around between I/Os, allocating those is a lot
+// more expensive than a plain new. Thread-safe; acquire never blocks, it
+// allocates a new buffer if none are free.
+class AlignedBufferPool {
+public:
+    class Lease {
+    public:
+        Lease(AlignedBufferPool* pool, std::unique_ptr<AlignedBuffer> buffer)
+            : pool(pool), buffer(std::move(buffer)) {}
+        ~Lease() { if (buffer) pool->release(std::move(buffer)); }
+        
+        Lease(Lease&&) = default;
+        Lease& operator=(Lease&&) = delete;
+        
+        AlignedBuffer& operator*() { return *buffer; }
+        AlignedBuffer* operator->() { return buffer.get(); }
+        
+    private:
+        AlignedBufferPool* pool;
+        std::unique_ptr<AlignedBuffer> buffer;
+    };
+    
+    AlignedBufferPool(size_t bufferSize, size_t maxIdle = 8)
+        : bufferSize(bufferSize), maxIdle(maxIdle) {}
+    
+    Lease acquire(size_t minSize = 0);
+    
+private:
+    size_t bufferSize;
+    size_t maxIdle;
+    std::mutex mtx;
+    std::vector<std::unique_ptr<AlignedBuffer>> idle;
+    
+    void release(std::unique_ptr<AlignedBuffer> buffer);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "StorageStrategy.h"
+#include "WriteAheadLog.h"
+#include <vector>
+#include <string>
+#include <chrono>
+
+// SingleFile layout, but every record is a checksummed frame in an
+// append-only log (see WriteAheadLog) and writes are made durable according
+// to a SyncPolicy. The index is just a cache for random reads; the log can
+// be read back without it.
+class AppendLogStrategy : public StorageStrategy {
+public:
+    AppendLogStrategy(const std::string& dir, SyncPolicy policy = SyncPolicy::PerBatch,
+                      size_t groupCommitBytes = 1024 * 1024,
+                      std::chrono::microseconds groupCommitDelay = std::chrono::microseconds(1000));
+    
+    void write(const std::vector<Record>& records) override;
+    void writeStream(RecordStream& stream) override;
+    bool supportsStreaming() const override { return true; }
+    std::vector<Record> readSequential() override;
+    std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void scanSequential(const RecordVisitor& visit) override;
+    void cleanUp() override;
+    std::string getName() const override;
+    
+    size_t getDiskSpaceUsed() const override;
+    size_t getNumFiles() const override { return 2; }
+    DurabilityStats getDurabilityStats() const override;
+    
+private:
+    std::string dataFile;
+    std::string indexFile;
+    std::vector<IndexEntry> index;  // offsets point at the payload, not the frame
+    WriteAheadLog::Options options;
+    WriteAheadLog::Stats lastWriteStats;
+    
+    void writeIndex();
+    void readIndex();
+};
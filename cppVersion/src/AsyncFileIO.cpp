@@ -0,0 +1,341 @@
+#include "AsyncFileIO.h"
+#include "WorkerPool.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+
+#ifdef DUNE_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#endif
+
+namespace {
+
+// Blocking I/O from a bunch of threads. Works everywhere, and on most
+// filesystems enough concurrent opens already hide a good chunk of the
+// metadata latency.
+class ThreadPoolFileIO : public AsyncFileIO {
+public:
+    explicit ThreadPoolFileIO(size_t numThreads) : pool(numThreads) {}
+    
+    void writeFiles(const std::vector<WriteOp>& ops) override {
+        pool.parallelFor(ops.size(), [&](size_t i) {
+            const auto& op = ops[i];
+            std::ofstream out(op.path, std::ios::binary);
+            if (!out) throw std::runtime_error("couldnt create record file");
+            out.write(op.data, op.size);
+            if (!out) throw std::runtime_error("write failed: " + op.path);
+        });
+    }
+    
+    void readFiles(const std::vector<ReadOp>& ops) override {
+        pool.parallelFor(ops.size(), [&](size_t i) {
+            const auto& op = ops[i];
+            std::ifstream in(op.path, std::ios::binary);
+            if (!in) throw std::runtime_error("Failed to open record file");
+            if (!in.read(op.dest, op.size))
+                throw std::runtime_error("short read: " + op.path);
+        });
+    }
+    
+    std::string name() const override {
+        return "threads";
+    }
+    
+private:
+    WorkerPool pool;
+};
+
+#ifdef DUNE_HAVE_IO_URING
+
+// Talks to the kernel directly instead of pulling in liburing. Every file
+// goes through openat -> read/write -> close; the read/write and close are
+// linked so they go out together once the fd is known, and new opens are
+// queued as soon as there is room, so up to queueDepth files are in flight.
+class IoUringFileIO : public AsyncFileIO {
+public:
+    // nullptr if the kernel doesn't have io_uring or is missing an opcode
+    static std::unique_ptr<IoUringFileIO> tryCreate(size_t queueDepth) {
+        std::unique_ptr<IoUringFileIO> io(new IoUringFileIO(queueDepth));
+        if (!io->setUp()) return nullptr;
+        return io;
+    }
+    
+    ~IoUringFileIO() override {
+        tearDown();
+    }
+    
+    void writeFiles(const std::vector<WriteOp>& ops) override {
+        run(ops.size(), true,
+            [&](size_t i) { return ops[i].path.c_str(); },
+            [&](size_t i) { return const_cast<char*>(ops[i].data); },
+            [&](size_t i) { return ops[i].size; });
+    }
+    
+    void readFiles(const std::vector<ReadOp>& ops) override {
+        run(ops.size(), false,
+            [&](size_t i) { return ops[i].path.c_str(); },
+            [&](size_t i) { return ops[i].dest; },
+            [&](size_t i) { return ops[i].size; });
+    }
+    
+    std::string name() const override {
+        return "io_uring";
+    }
+    
+private:
+    enum Stage : uint64_t { Open = 0, Transfer = 1, Close = 2 };
+    
+    size_t queueDepth;
+    int ringFd = -1;
+    
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    
+    unsigned localTail = 0;
+    unsigned toSubmit = 0;
+    
+    explicit IoUringFileIO(size_t queueDepth)
+        : queueDepth(std::max<size_t>(1, queueDepth)) {}
+    
+    bool setUp() {
+        // an active file has at most two SQEs queued (transfer + close)
+        unsigned entries = static_cast<unsigned>(std::min<size_t>(queueDepth * 2, 32768));
+        
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) return false;
+        
+        // the kernel rounds entries up, the CQ ring is twice that by default
+        queueDepth = std::min<size_t>(queueDepth, params.sq_entries / 2);
+        
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) { sqRing = nullptr; return false; }
+        
+        if (singleMmap) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) { cqRing = nullptr; return false; }
+        }
+        
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqeMem = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqeMem == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(sqeMem);
+        
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        localTail = *sqTail;
+        
+        return supportsOpcodes();
+    }
+    
+    void tearDown() {
+        if (sqes) munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) ::close(ringFd);
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        ringFd = -1;
+    }
+    
+    bool supportsOpcodes() {
+        // openat/read/write/close landed in 5.6, older kernels fail each op
+        // with EINVAL which we'd rather find out about up front
+        constexpr unsigned maxOps = 256;
+        std::vector<char> buf(sizeof(io_uring_probe) + maxOps * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buf.data());
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, maxOps) < 0)
+            return false;
+        
+        for (unsigned op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+    
+    io_uring_sqe* nextSqe() {
+        unsigned idx = localTail & *sqMask;
+        io_uring_sqe* sqe = &sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[idx] = idx;
+        ++localTail;
+        ++toSubmit;
+        return sqe;
+    }
+    
+    // 0, or the errno io_uring_enter failed with
+    int submitAndWait(unsigned minComplete) {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        while (true) {
+            long ret = syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                toSubmit -= static_cast<unsigned>(ret);
+                return 0;
+            }
+            if (errno != EINTR) return errno;
+        }
+    }
+    
+    template <typename PathFn, typename BufFn, typename SizeFn>
+    void run(size_t count, bool writing, PathFn path, BufFn buffer, SizeFn size) {
+        if (ringFd < 0) throw std::runtime_error("io_uring ring was shut down after an earlier failure");
+        // everything gets checked before the first SQE, a throw from inside
+        // the loop would leave ops in flight
+        for (size_t i = 0; i < count; ++i) {
+            if (size(i) > UINT32_MAX)
+                throw std::runtime_error("record too large for a single io_uring op");
+        }
+        
+        std::vector<int> fds(count, -1);
+        std::string error;
+        auto fail = [&](size_t i, const char* what, int err) {
+            if (error.empty())
+                error = std::string(what) + " " + path(i) + ": " + std::strerror(err);
+        };
+        
+        size_t next = 0;
+        size_t active = 0;
+        size_t stuck = 0;
+        
+        while (true) {
+            // stop starting new files once something failed, but still
+            // drain what's in flight so nobody writes into freed buffers
+            while (error.empty() && next < count && active < queueDepth) {
+                io_uring_sqe* sqe = nextSqe();
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(path(next));
+                sqe->open_flags = writing ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+                sqe->len = writing ? 0644 : 0;
+                sqe->user_data = (next << 2) | Open;
+                ++next;
+                ++active;
+            }
+            if (active == 0) break;
+            
+            int err = submitAndWait(1);
+            
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            if (err != 0) {
+                if (error.empty()) error = std::string("io_uring_enter: ") + std::strerror(err);
+                // EAGAIN/EBUSY go away as completions are reaped, keep going
+                // until everything's back. Anything else, or no progress at
+                // all, and closing the ring is the only way to get the
+                // kernel to cancel what it still has before we return.
+                stuck = head == tail ? stuck + 1 : 0;
+                if ((err != EAGAIN && err != EBUSY) || stuck > 1000) {
+                    tearDown();
+                    throw std::runtime_error(error);
+                }
+                if (head == tail) std::this_thread::yield();
+            }
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & *cqMask];
+                size_t i = static_cast<size_t>(cqe.user_data >> 2);
+                auto stage = static_cast<Stage>(cqe.user_data & 3);
+                int res = cqe.res;
+                
+                if (stage == Open) {
+                    if (res < 0) {
+                        fail(i, writing ? "couldnt create" : "couldnt open", -res);
+                        --active;
+                    } else if (!error.empty()) {
+                        ::close(res);
+                        --active;
+                    } else {
+                        fds[i] = res;
+                        io_uring_sqe* io = nextSqe();
+                        io->opcode = writing ? IORING_OP_WRITE : IORING_OP_READ;
+                        io->fd = res;
+                        io->addr = reinterpret_cast<uint64_t>(buffer(i));
+                        io->len = static_cast<uint32_t>(size(i));
+                        io->off = 0;
+                        io->flags = IOSQE_IO_LINK;
+                        io->user_data = (i << 2) | Transfer;
+                        
+                        io_uring_sqe* cl = nextSqe();
+                        cl->opcode = IORING_OP_CLOSE;
+                        cl->fd = res;
+                        cl->user_data = (i << 2) | Close;
+                    }
+                } else if (stage == Transfer) {
+                    if (res < 0) fail(i, writing ? "write" : "read", -res);
+                    else if (static_cast<size_t>(res) != size(i)) fail(i, writing ? "short write" : "short read", EIO);
+                } else {
+                    // a failed transfer breaks the link and cancels the close
+                    if (res == -ECANCELED) ::close(fds[i]);
+                    else if (res < 0) fail(i, "close", -res);
+                    --active;
+                }
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+        
+        if (!error.empty()) throw std::runtime_error(error);
+    }
+};
+
+#endif
+
+}
+
+std::unique_ptr<AsyncFileIO> AsyncFileIO::create(IoEngine engine, size_t queueDepth) {
+    // more threads than this just fight over the directory locks
+    const size_t maxThreads = 64;
+    
+    switch (engine) {
+    case IoEngine::Sync:
+        return nullptr;
+    case IoEngine::IoUring:
+#ifdef DUNE_HAVE_IO_URING
+        if (auto io = IoUringFileIO::tryCreate(queueDepth)) return io;
+#endif
+        std::cout << "    [Note: io_uring not available - using thread pool instead]" << std::endl;
+        return std::make_unique<ThreadPoolFileIO>(std::min(queueDepth, maxThreads));
+    case IoEngine::ThreadPool:
+        return std::make_unique<ThreadPoolFileIO>(std::min(queueDepth, maxThreads));
+    }
+    return nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+enum class IoEngine {
+    Sync,       // plain fstreams, one file at a time
+    IoUring,    // io_uring, falls back to ThreadPool if the kernel says no
+    ThreadPool  // blocking I/O from a pool of threads
+};
+
+// Whole-file writes and reads for lots of small files. For the per-record
+// layout the cost is open/close metadata latency rather than bandwidth, so
+// the engines just try to keep as many files in flight as possible.
+class AsyncFileIO {
+public:
+    struct WriteOp {
+        std::string path;
+        const char* data;
+        size_t size;
+    };
+    
+    struct ReadOp {
+        std::string path;
+        char* dest;
+        size_t size;
+    };
+    
+    // returns nullptr for IoEngine::Sync
+    static std::unique_ptr<AsyncFileIO> create(IoEngine engine, size_t queueDepth);
+    
+    virtual ~AsyncFileIO() = default;
+    
+    // both block until every op has finished, and throw if any of them failed
+    virtual void writeFiles(const std::vector<WriteOp>& ops) = 0;
+    virtual void readFiles(const std::vector<ReadOp>& ops) = 0;
+    virtual std::string name() const = 0;
+};
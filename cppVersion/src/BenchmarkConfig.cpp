@@ -0,0 +1,198 @@
+#include "BenchmarkConfig.h"
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+const char* const valueOptions[] = {
+    "--records", "--seed", "--min-size", "--max-size", "--size-dist", "--compressibility",
+    "--chunk-size", "--threads", "--cache-mb", "--coalesce-gap", "--strategies",
+    "--reps", "--random-reads", "--pattern-reads", "--pattern-batch", "--scaling-ms", "--auto-compact",
+    "--json", "--csv"};
+
+size_t parseCount(const std::string& opt, const std::string& value) {
+    size_t pos = 0;
+    unsigned long long v = 0;
+    try {
+        v = std::stoull(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos != value.size() || value.empty() || value[0] == '-')
+        throw std::invalid_argument(opt + " expects a non-negative integer, got '" + value + "'");
+    return static_cast<size_t>(v);
+}
+
+double parseFraction(const std::string& opt, const std::string& value) {
+    size_t pos = 0;
+    double v = 0.0;
+    try {
+        v = std::stod(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos != value.size() || v < 0.0 || v > 1.0)
+        throw std::invalid_argument(opt + " expects a number between 0 and 1, got '" + value + "'");
+    return v;
+}
+
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+}
+
+BenchmarkConfig BenchmarkConfig::parse(int argc, char** argv) {
+    BenchmarkConfig config;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "-h" || arg == "--help") {
+            config.showHelp = true;
+            continue;
+        }
+        if (arg == "--list") {
+            config.listStrategies = true;
+            continue;
+        }
+        if (arg == "--no-coalesce") {
+            config.coalesce = false;
+            continue;
+        }
+        if (arg == "--no-checksums") {
+            config.checksums = false;
+            continue;
+        }
+        if (arg == "--stream") {
+            config.streaming = true;
+            continue;
+        }
+        if (arg == "--legacy-generator") {
+            config.legacyGenerator = true;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0) throw std::invalid_argument("unexpected argument '" + arg + "'");
+        
+        // --opt=value or --opt value
+        std::string opt = arg;
+        std::string value;
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            opt = arg.substr(0, eq);
+            value = arg.substr(eq + 1);
+        }
+        if (std::find(std::begin(valueOptions), std::end(valueOptions), opt) == std::end(valueOptions)) {
+            throw std::invalid_argument("unknown option '" + opt + "'");
+        }
+        if (eq == std::string::npos) {
+            if (i + 1 >= argc) throw std::invalid_argument(opt + " needs a value");
+            value = argv[++i];
+        }
+        
+        if (opt == "--records") {
+            config.numRecords = parseCount(opt, value);
+        } else if (opt == "--seed") {
+            config.seed = static_cast<unsigned int>(parseCount(opt, value));
+        } else if (opt == "--min-size") {
+            config.minRecordSize = parseCount(opt, value);
+        } else if (opt == "--max-size") {
+            config.maxRecordSize = parseCount(opt, value);
+        } else if (opt == "--size-dist") {
+            if (value == "uniform") config.sizeDist = SizeDistribution::Uniform;
+            else if (value == "lognormal") config.sizeDist = SizeDistribution::LogNormal;
+            else throw std::invalid_argument("--size-dist must be uniform or lognormal");
+        } else if (opt == "--compressibility") {
+            config.compressibility = parseFraction(opt, value);
+        } else if (opt == "--chunk-size") {
+            config.recordsPerChunk = parseCount(opt, value);
+        } else if (opt == "--threads") {
+            config.threads = parseCount(opt, value);
+        } else if (opt == "--cache-mb") {
+            config.cacheMB = parseCount(opt, value);
+        } else if (opt == "--coalesce-gap") {
+            config.coalesceGap = parseCount(opt, value);
+        } else if (opt == "--strategies") {
+            config.strategies = splitList(value);
+        } else if (opt == "--reps") {
+            config.repetitions = parseCount(opt, value);
+        } else if (opt == "--random-reads") {
+            config.randomReads = parseCount(opt, value);
+        } else if (opt == "--pattern-reads") {
+            config.patternReads = parseCount(opt, value);
+        } else if (opt == "--pattern-batch") {
+            config.patternBatch = parseCount(opt, value);
+        } else if (opt == "--scaling-ms") {
+            config.scalingMillis = parseCount(opt, value);
+        } else if (opt == "--auto-compact") {
+            config.autoCompact = parseFraction(opt, value);
+        } else if (opt == "--json") {
+            config.jsonPath = value;
+        } else if (opt == "--csv") {
+            config.csvPath = value;
+        }
+    }
+    
+    if (config.numRecords == 0) throw std::invalid_argument("--records must be > 0");
+    if (config.numRecords > static_cast<size_t>(std::numeric_limits<int>::max()))
+        throw std::invalid_argument("--records must fit in a record id (int)");
+    if (config.minRecordSize == 0 || config.minRecordSize > config.maxRecordSize)
+        throw std::invalid_argument("need 0 < --min-size <= --max-size");
+    if (config.recordsPerChunk == 0) throw std::invalid_argument("--chunk-size must be > 0");
+    if (config.repetitions == 0) throw std::invalid_argument("--reps must be > 0");
+    if (config.patternBatch == 0) throw std::invalid_argument("--pattern-batch must be > 0");
+    if (config.cacheMB == 0) throw std::invalid_argument("--cache-mb must be > 0");
+    
+    return config;
+}
+
+void BenchmarkConfig::printUsage(std::ostream& out, const char* program) {
+    out << "usage: " << program << " [options]\n"
+        << "\n"
+        << "data:\n"
+        << "  --records N           records to generate (100000)\n"
+        << "  --seed N              generator and access pattern seed (24)\n"
+        << "  --min-size B          smallest record in bytes (1024)\n"
+        << "  --max-size B          largest record in bytes (2048)\n"
+        << "  --size-dist D         uniform or lognormal (uniform)\n"
+        << "  --compressibility F   0-1, share of quiet baseline in records (0.6)\n"
+        << "  --stream              regenerate records on the fly and verify by checksum,\n"
+        << "                        for datasets that don't fit in memory\n"
+        << "  --legacy-generator    old single-threaded mt19937 data instead of the\n"
+        << "                        parallel counter-based generator\n"
+        << "\n"
+        << "strategies:\n"
+        << "  --strategies A,B,...  which strategies to run, see --list (all)\n"
+        << "  --chunk-size N        records per chunk for Chunked (1000)\n"
+        << "  --threads N           workers for Chunked(xN) and data generation, max for the\n"
+        << "                        Sharded and read scaling sweeps (auto)\n"
+        << "  --coalesce-gap B      merge random reads up to B bytes apart into one preadv (16384)\n"
+        << "  --no-coalesce         one read per record instead\n"
+        << "  --no-checksums        don't store/check per-record crc32c in the indexes\n"
+        << "  --cache-mb N          block cache size for the +cache runs (32)\n"
+        << "\n"
+        << "runs:\n"
+        << "  --reps N              repeat every strategy N times (1)\n"
+        << "  --random-reads N      uniform random reads per strategy (1000)\n"
+        << "  --pattern-reads N     reads per access pattern, 0 to skip the sweep (100000)\n"
+        << "  --pattern-batch N     reads per readRandom call in the sweep (1000)\n"
+        << "  --scaling-ms N        how long each reader thread count runs in the read\n"
+        << "                        scaling sweep, 0 to skip it (500)\n"
+        << "  --auto-compact F      compact in the background during the updates once more\n"
+        << "                        than F of the bytes are dead, with a reader checking\n"
+        << "                        records meanwhile; 0 turns it off (0.005)\n"
+        << "\n"
+        << "output:\n"
+        << "  --json PATH           write all results as JSON\n"
+        << "  --csv PATH            write one CSV row per strategy run\n"
+        << "  --list                list strategy names and exit\n"
+        << "  -h, --help            this text\n";
+}
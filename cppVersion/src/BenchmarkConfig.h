@@ -0,0 +1,44 @@
+#pragma once
+#include "DataGenerator.h"
+#include "ReadPlanner.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+
+// Everything main() used to hardcode. Defaults reproduce the old run.
+struct BenchmarkConfig {
+    size_t numRecords = 100000;
+    unsigned int seed = 24;
+    size_t minRecordSize = 1024;
+    size_t maxRecordSize = 2048;
+    SizeDistribution sizeDist = SizeDistribution::Uniform;
+    double compressibility = 0.6;
+    bool streaming = false;        // regenerate records on the fly, see StreamingGenerator
+    bool legacyGenerator = false;  // the old single-threaded mt19937 DataGenerator
+    
+    size_t recordsPerChunk = 1000;
+    size_t threads = 0;            // 0 = pick from the hardware
+    size_t cacheMB = 32;
+    bool checksums = true;         // per-record crc32c in SingleFile/Chunked indexes
+    bool coalesce = true;          // merge nearby random reads into one preadv
+    size_t coalesceGap = ReadPlanner::defaultMaxGap;
+    std::vector<std::string> strategies;  // empty = all of them
+    
+    size_t repetitions = 1;
+    size_t randomReads = 1000;     // uniform, per strategy
+    size_t patternReads = 100000;  // per access pattern, 0 skips the sweep
+    size_t patternBatch = 1000;
+    size_t scalingMillis = 500;    // per reader thread count, 0 skips the sweep
+    double autoCompact = 0.005;    // garbage ratio for background compaction during updates, 0 = off
+    
+    std::string jsonPath;
+    std::string csvPath;
+    
+    bool showHelp = false;
+    bool listStrategies = false;
+    
+    // throws std::invalid_argument with a message fit for the user
+    static BenchmarkConfig parse(int argc, char** argv);
+    static void printUsage(std::ostream& out, const char* program);
+};
@@ -1,5 +1,9 @@
 #pragma once
+#include "LatencyHistogram.h"
+#include "Statistics.h"
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <cstddef>
 
 struct BenchmarkMetrics {
@@ -8,17 +12,59 @@ struct BenchmarkMetrics {
     double writeTime = 0.0;
     double seqReadTime = 0.0;
     double randReadTime = 0.0;
+    double scanTime = 0.0;      // scanSequential, no per-record copies
+    double randScanTime = 0.0;
     
     size_t diskSpaceUsed = 0;
     size_t numFiles = 0;
     size_t totalDataSize = 0;
+    size_t paddingBytes = 0;    // alignment padding written in Direct mode
+    size_t numRecords = 100000;
+    size_t numRandomReads = 1000;
+    
+    // only filled in by strategies that fsync
+    size_t syncCount = 0;
+    double avgCommitLatency = 0.0;  // seconds
+    double maxCommitLatency = 0.0;
+    
+    // block cache over the random read + random scan phases, if one was set
+    bool cacheEnabled = false;
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+    size_t cacheEvictions = 0;
+    
+    // descriptor reuse, for strategies that keep files open between reads
+    size_t fdOpens = 0;
+    size_t fdReuses = 0;
+    size_t fdEvictions = 0;
+    
+    // per-record latency distributions (empty if the strategy can't time
+    // individual records)
+    LatencySummary writeLat;
+    LatencySummary seqReadLat;
+    LatencySummary randReadLat;
+    LatencySummary pointReadLat;  // one readOne() call each
+    LatencySummary updateLat;     // one update() call each, empty without updates
+    
+    // update phase: garbage left behind and one compact() over it, if the
+    // strategy has one
+    size_t deadBytes = 0;
+    size_t backgroundCompactions = 0;  // started by the updates themselves
+    bool compacted = false;
+    size_t reclaimedBytes = 0;
+    double compactTime = 0.0;
+    // the same records again through append(), in batches
+    double appendTime = 0.0;
+    
+    // readSequentialBatch(), 0 when not run (streaming)
+    double seqReadBatchTime = 0.0;
     
     bool dataVerified = false;  // did the read-back match?
     
-    // latencies in ms
-    double writeLatency()   const { return writeTime    / 100000.0 * 1000.0; }
-    double seqReadLatency() const { return seqReadTime  / 100000.0 * 1000.0; }
-    double randReadLatency()const { return randReadTime / 1000.0   * 1000.0; }
+    // average latencies in ms
+    double writeLatency()   const { return writeTime    / numRecords     * 1000.0; }
+    double seqReadLatency() const { return seqReadTime  / numRecords     * 1000.0; }
+    double randReadLatency()const { return randReadTime / numRandomReads * 1000.0; }
     
     // MB/s
     double writeThroughput() const {
@@ -27,4 +73,76 @@ struct BenchmarkMetrics {
     double seqReadThroughput() const {
         return (totalDataSize / (1024.0 * 1024.0)) / seqReadTime;
     }
+    double scanThroughput() const {
+        return (totalDataSize / (1024.0 * 1024.0)) / scanTime;
+    }
+    
+    double cacheHitRate() const {
+        return cacheHits + cacheMisses ? static_cast<double>(cacheHits) / (cacheHits + cacheMisses) : 0.0;
+    }
+    
+    // payload bytes per byte on disk (index included), > 1 means it shrank
+    double compressionRatio() const {
+        return diskSpaceUsed ? static_cast<double>(totalDataSize) / diskSpaceUsed : 0.0;
+    }
+};
+
+// every repetition of one strategy
+struct StrategyRuns {
+    std::string strategy;
+    std::vector<BenchmarkMetrics> runs;
+    
+    bool allVerified() const {
+        for (const auto& r : runs) {
+            if (!r.dataVerified) return false;
+        }
+        return !runs.empty();
+    }
+    
+    // e.g. stats([](const BenchmarkMetrics& m) { return m.writeTime; })
+    template <typename Get>
+    SampleStats stats(Get get) const {
+        std::vector<double> samples;
+        samples.reserve(runs.size());
+        for (const auto& r : runs) samples.push_back(get(r));
+        return SampleStats::of(samples);
+    }
+};
+
+// one strategy reading one access pattern (see AccessPattern)
+struct WorkloadMetrics {
+    std::string strategy;
+    std::string workload;
+    size_t reads = 0;
+    size_t distinctRecords = 0;
+    double readTime = 0.0;
+    bool cacheEnabled = false;
+    double cacheHitRate = 0.0;
+    bool dataVerified = false;
+    
+    double readsPerSecond() const { return readTime > 0.0 ? reads / readTime : 0.0; }
+};
+
+// one strategy instance shared by `threads` threads doing random readOne()
+// calls for a fixed time, with `writer` one more thread changing records
+struct ScalingMetrics {
+    std::string strategy;
+    size_t threads = 0;
+    bool writer = false;
+    size_t writes = 0;                      // records updated or appended
+    size_t reads = 0;
+    double readTime = 0.0;
+    LatencySummary lat;                     // every read from every thread
+    std::vector<LatencySummary> threadLat;  // each thread on its own
+    bool dataVerified = false;
+    
+    double readsPerSecond() const { return readTime > 0.0 ? reads / readTime : 0.0; }
+    double writesPerSecond() const { return readTime > 0.0 ? writes / readTime : 0.0; }
+    
+    // the unluckiest thread's p99, how evenly the threads share the store
+    double worstThreadP99() const {
+        double worst = 0.0;
+        for (const auto& t : threadLat) worst = std::max(worst, t.p99);
+        return worst;
+    }
 };
@@ -0,0 +1,107 @@
+#include "BlockCache.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+BlockCache::BlockCache(size_t capacityBytes, size_t blockSize, size_t numShards)
+    : capacityBytes(capacityBytes), blockBytes(blockSize),
+      shards(std::max<size_t>(1, numShards)) {
+    if (blockSize == 0) throw std::invalid_argument("block size must be > 0");
+    // every shard can hold at least one block, or nothing would ever stick
+    shardCapacity = std::max(blockSize, capacityBytes / shards.size());
+}
+
+BlockCache::FileId BlockCache::fileId(const std::string& path) {
+    std::lock_guard<std::mutex> lock(filesMutex);
+    auto it = files.find(path);
+    if (it != files.end()) return it->second;
+    FileId id = nextFileId++;
+    files.emplace(path, id);
+    return id;
+}
+
+void BlockCache::forget(const std::string& path) {
+    std::lock_guard<std::mutex> lock(filesMutex);
+    files.erase(path);
+}
+
+BlockCache::Block BlockCache::getBlock(const Key& key, size_t need, const BlockLoader& load) {
+    Shard& shard = shardFor(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end() && it->second->data->size() >= need) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            shard.hits++;
+            return it->second->data;
+        }
+    }
+    shard.misses++;
+    
+    auto data = std::make_shared<std::vector<char>>(blockBytes);
+    size_t got = load(key.block * blockBytes, data->data(), blockBytes);
+    data->resize(got);
+    
+    std::lock_guard<std::mutex> lock(shard.m);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        // someone beat us to it, or cached the end of the file before it grew
+        if (it->second->data->size() >= data->size()) return it->second->data;
+        it->second->data = data;
+        return data;
+    }
+    
+    shard.lru.push_front({key, data});
+    shard.map.emplace(key, shard.lru.begin());
+    shard.bytes += blockBytes;
+    while (shard.bytes > shardCapacity && shard.lru.size() > 1) {
+        shard.map.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+        shard.bytes -= blockBytes;
+        shard.evictions++;
+    }
+    return data;
+}
+
+void BlockCache::read(FileId file, size_t offset, size_t len, char* dest, const BlockLoader& load) {
+    while (len > 0) {
+        uint64_t block = offset / blockBytes;
+        size_t within = offset % blockBytes;
+        size_t n = std::min(len, blockBytes - within);
+        
+        Block data = getBlock({file, block}, within + n, load);
+        if (within + n > data->size()) throw std::runtime_error("block cache read past end of file");
+        std::memcpy(dest, data->data() + within, n);
+        
+        dest += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+void BlockCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.m);
+        shard.map.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+BlockCache::Stats BlockCache::stats() const {
+    Stats total;
+    for (const auto& shard : shards) {
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.evictions += shard.evictions;
+    }
+    return total;
+}
+
+void BlockCache::resetStats() {
+    for (auto& shard : shards) {
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.evictions = 0;
+    }
+}
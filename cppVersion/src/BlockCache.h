@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// Bounded LRU cache of fixed-size file blocks, keyed by (file, block index).
+// Split into shards, each with its own lock and LRU list, so parallel
+// readers mostly don't contend. One cache can be shared by several
+// strategies - files are told apart by the id fileId() hands out for a path.
+// When a file is rewritten, forget() its path: it gets a fresh id and the
+// stale blocks just age out of the LRU. Files that only grow don't need
+// that - a cached last block too short for a read is loaded again.
+//
+// Blocks are loaded outside the shard lock, so two threads missing on the
+// same block at once both read it (the second copy is dropped).
+class BlockCache {
+public:
+    using FileId = uint32_t;
+    using Block = std::shared_ptr<const std::vector<char>>;
+    // fill buf with up to blockSize bytes starting at offset, return how many
+    // (less than blockSize only at end of file)
+    using BlockLoader = std::function<size_t(size_t offset, char* buf, size_t blockSize)>;
+    
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        
+        double hitRate() const {
+            return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+        }
+    };
+    
+    BlockCache(size_t capacityBytes, size_t blockSize = 64 * 1024, size_t numShards = 16);
+    
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+    
+    FileId fileId(const std::string& path);
+    
+    // copies [offset, offset + len) of the file into dest, one block at a
+    // time, calling load for any block that isn't cached
+    void read(FileId file, size_t offset, size_t len, char* dest, const BlockLoader& load);
+    
+    // call after rewriting or deleting a file
+    void forget(const std::string& path);
+    void clear();
+    
+    size_t blockSize() const { return blockBytes; }
+    size_t capacity() const { return capacityBytes; }
+    Stats stats() const;
+    void resetStats();
+    
+private:
+    struct Key {
+        FileId file;
+        uint64_t block;
+        bool operator==(const Key& o) const { return file == o.file && block == o.block; }
+    };
+    
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<uint64_t>()(k.block * 0x9E3779B97F4A7C15ull ^ k.file);
+        }
+    };
+    
+    struct Entry {
+        Key key;
+        Block data;
+    };
+    
+    struct alignas(64) Shard {
+        std::mutex m;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map;
+        size_t bytes = 0;
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> evictions{0};
+    };
+    
+    size_t capacityBytes;
+    size_t blockBytes;
+    size_t shardCapacity;
+    std::vector<Shard> shards;
+    
+    std::mutex filesMutex;
+    std::unordered_map<std::string, FileId> files;
+    FileId nextFileId = 0;
+    
+    Shard& shardFor(const Key& key) { return shards[KeyHash()(key) % shards.size()]; }
+    // a cached block shorter than need counts as a miss
+    Block getBlock(const Key& key, size_t need, const BlockLoader& load);
+};
@@ -0,0 +1,151 @@
+#include "Checksum.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DUNE_CRC_X86 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+// reflected polynomial 0x1EDC6F41
+constexpr uint32_t poly = 0x82F63B78u;
+
+// table[k][b] is the crc of byte b followed by k zero bytes, so eight
+// bytes can be folded in with eight independent lookups
+using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+Tables makeTables() {
+    Tables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int k = 1; k < 8; ++k) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+    }
+    return t;
+}
+
+const Tables tables = makeTables();
+
+// The hardware path runs three independent crcs over adjacent stripes to
+// hide the 3 cycle latency of the instruction, then stitches them
+// together. shiftTables[k][b] is the crc state after `stripe` zero bytes
+// starting from b << 8k, i.e. what "append stripe bytes" does to a state.
+constexpr size_t stripe = 128;
+
+using ShiftTables = std::array<std::array<uint32_t, 256>, 4>;
+
+ShiftTables makeShiftTables() {
+    ShiftTables t{};
+    for (int k = 0; k < 4; ++k) {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t c = b << (8 * k);
+            for (size_t i = 0; i < stripe; ++i) c = tables[0][c & 0xFF] ^ (c >> 8);
+            t[k][b] = c;
+        }
+    }
+    return t;
+}
+
+const ShiftTables shiftTables = makeShiftTables();
+
+uint32_t shiftStripe(uint32_t c) {
+    return shiftTables[0][c & 0xFF] ^ shiftTables[1][(c >> 8) & 0xFF] ^
+           shiftTables[2][(c >> 16) & 0xFF] ^ shiftTables[3][c >> 24];
+}
+
+uint32_t crcSoftware(const uint8_t* p, size_t len, uint32_t crc) {
+    while (len >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;  // little endian only, same as the on-disk formats
+        crc = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF] ^
+              tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24] ^
+              tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF] ^
+              tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef DUNE_CRC_X86
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crcHardware(const uint8_t* p, size_t len, uint32_t crc) {
+#if defined(__x86_64__) || defined(_M_X64)
+    // crc(s, A|B) = shift(crc(s, A), |B|) ^ crc(0, B), the crc is linear
+    while (len >= 3 * stripe) {
+        uint64_t c0 = crc, c1 = 0, c2 = 0;
+        for (size_t i = 0; i < stripe; i += 8) {
+            uint64_t v0, v1, v2;
+            std::memcpy(&v0, p + i, 8);
+            std::memcpy(&v1, p + stripe + i, 8);
+            std::memcpy(&v2, p + 2 * stripe + i, 8);
+            c0 = _mm_crc32_u64(c0, v0);
+            c1 = _mm_crc32_u64(c1, v1);
+            c2 = _mm_crc32_u64(c2, v2);
+        }
+        crc = shiftStripe(shiftStripe(static_cast<uint32_t>(c0)) ^ static_cast<uint32_t>(c1)) ^
+              static_cast<uint32_t>(c2);
+        p += 3 * stripe;
+        len -= 3 * stripe;
+    }
+    
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(c);
+#endif
+    while (len >= 4) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+    while (len--) crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+
+bool cpuHasSse42() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+const bool useHardware = cpuHasSse42();
+#else
+const bool useHardware = false;
+#endif
+}
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+    const auto* p = static_cast<const uint8_t*>(data);
+#ifdef DUNE_CRC_X86
+    if (useHardware) return ~crcHardware(p, len, ~crc);
+#endif
+    return ~crcSoftware(p, len, ~crc);
+}
+
+bool crc32cHardware() {
+    return useHardware;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// CRC32C (Castagnoli). Pass the previous result as crc to checksum a
+// buffer in pieces. Uses the SSE4.2 crc32 instruction when the CPU has
+// it (checked once at startup), slicing-by-8 tables otherwise.
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+// which implementation crc32c() ended up with, for the report
+bool crc32cHardware();
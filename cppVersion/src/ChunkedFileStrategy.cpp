@@ -3,95 +3,470 @@
 #include <filesystem>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+#include "WorkerPool.h"
+#include "DirectFile.h"
 
 namespace fs = std::filesystem;
 
-ChunkedFileStrategy::ChunkedFileStrategy(const std::string& dir, size_t recordsPerChunk)
-    : recordsPerChunk(recordsPerChunk) {
+namespace {
+// header in front of every compressed chunk file. Stored raw with both
+// sizes 0 it's open-ended: the payload is the rest of the file.
+struct ChunkHeader {
+    uint32_t magic;
+    uint8_t codec;
+    uint8_t reserved[3];
+    uint32_t rawSize;
+    uint32_t storedSize;
+};
+static_assert(sizeof(ChunkHeader) == 16, "chunk header layout changed");
+
+constexpr uint32_t chunkMagic = 0x434E5544;  // "DUNC"
+constexpr size_t chunkCacheSize = 16;        // decompressed chunks kept around
+constexpr size_t minFoldEntries = 4096;      // log entries before foldLog() bothers
+}
+
+ChunkedFileStrategy::ChunkedFileStrategy(const std::string& dir, size_t recordsPerChunk,
+                                         size_t numWorkers, IoMode mode, CodecId codecId)
+    : recordsPerChunk(recordsPerChunk), numWorkers(std::max<size_t>(1, numWorkers)),
+      mode(mode), bufferPool(1024 * 1024, this->numWorkers + 1) {
+    if (recordsPerChunk == 0) throw std::invalid_argument("recordsPerChunk must be > 0");
+    if (mode == IoMode::Mmap) throw std::invalid_argument("Chunked: mmap mode not supported");
     baseDir = dir;
     indexFile = dir + "/chunked_index.idx";
+    logFile = dir + "/chunked_index.log";
     fs::create_directories(dir);
+    if (this->numWorkers > 1) pool = std::make_unique<WorkerPool>(this->numWorkers);
+    if (codecId != CodecId::None) codec = Codec::create(codecId);
+}
+
+ChunkedFileStrategy::~ChunkedFileStrategy() {
+    try {
+        waitForCompaction();
+    } catch (...) {
+    }
+}
+
+std::string ChunkedFileStrategy::getName() const {
+    std::string options;
+    if (numWorkers > 1) options += "x" + std::to_string(numWorkers);
+    if (mode == IoMode::Direct) options += options.empty() ? "direct" : ",direct";
+    if (codec) options += (options.empty() ? "" : ",") + codec->name();
+    return options.empty() ? "Chunked" : "Chunked(" + options + ")";
 }
 
 std::string ChunkedFileStrategy::getChunkFileName(int chunkId) const {
     return baseDir + "/chunk_" + std::to_string(chunkId) + ".dat";
 }
 
-void ChunkedFileStrategy::write(const std::vector<Record>& records) {
-    index.clear();
-    index.resize(records.size());  // direct indexing by record ID
-    recordOrder.clear();
-    recordOrder.reserve(records.size());
+void ChunkedFileStrategy::forEachTask(size_t count, const std::function<void(size_t)>& task) {
+    if (pool && !onCompactorThread()) {
+        pool->parallelFor(count, task);
+    } else {
+        for (size_t i = 0; i < count; ++i) task(i);
+    }
+}
+
+std::vector<ChunkedFileStrategy::ChunkRun> ChunkedFileStrategy::chunkRuns(const Snapshot& snap) const {
+    // removed records are skipped; runs only go forwards through a chunk,
+    // which records moved by update() don't necessarily do
+    std::vector<ChunkRun> runs;
+    size_t runEnd = 0;
+    for (size_t pos = 0; pos < snap.recordOrder.size(); ++pos) {
+        const auto& entry = snap.index[snap.recordOrder[pos]];
+        if (entry.recordId == IndexFile::removed) continue;
+        if (runs.empty() || runs.back().chunkId != entry.recordId || entry.offset < runEnd)
+            runs.push_back({entry.recordId, pos, pos});
+        runs.back().end = pos + 1;
+        runEnd = entry.offset + entry.size;
+    }
+    return runs;
+}
+
+void ChunkedFileStrategy::writeChunk(int chunkId, const Record* records, size_t count, size_t firstPos,
+                                     std::vector<IndexEntry>& entries, std::vector<int>& order) {
+    std::vector<IndexEntry> stored(count);
+    storeChunk(chunkId, records, count, stored.data());
+    for (size_t i = 0; i < count; ++i) {
+        // store chunk number in the recordId field
+        entries[records[i].id] = stored[i];
+        order[firstPos + i] = records[i].id;
+    }
+}
+
+void ChunkedFileStrategy::storeChunk(int chunkId, const Record* records, size_t count,
+                                     IndexEntry* entries) {
+    if (codec) {
+        storeChunkCompressed(chunkId, records, count, entries);
+        return;
+    }
+    if (mode == IoMode::Direct) {
+        storeChunkDirect(chunkId, records, count, entries);
+        return;
+    }
     
-    int currentChunk = -1;
-    std::ofstream out;
-    size_t recordsInCurrentChunk = 0;
-    size_t currentOffset = 0;  // track manually, tellp() was slow
+    std::ofstream out(getChunkFileName(chunkId), std::ios::binary);
+    if (!out) throw std::runtime_error("Failed to open chunk file");
     
     constexpr size_t bufferSize = 1024 * 1024;
     std::vector<char> buffer(bufferSize);
+    out.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
     
-    for (const auto& record : records) {
-        if (recordsInCurrentChunk == 0) {
-            if (out.is_open()) out.close();
-            currentChunk++;
-            currentOffset = 0;
-            out.open(getChunkFileName(currentChunk), std::ios::binary);
-            if (!out) throw std::runtime_error("Failed to open chunk file");
-            out.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
-        }
-        
+    size_t currentOffset = 0;  // track manually, tellp() was slow
+    OpLap timer = lap(OpType::Write);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& record = records[i];
         out.write(record.data.data(), record.data.size());
-        
-        // store chunk number in the recordId field
-        index[record.id] = IndexEntry(currentChunk, currentOffset, record.data.size());
-        recordOrder.push_back(record.id);
+        entries[i] = IndexEntry(chunkId, currentOffset, record.data.size(),
+                                recordChecksum(record.data.data(), record.data.size()));
         currentOffset += record.data.size();
-        
-        recordsInCurrentChunk++;
-        if (recordsInCurrentChunk >= recordsPerChunk)
-            recordsInCurrentChunk = 0;
+        timer.mark();
     }
     
-    totalChunks = currentChunk + 1;
-    if (out.is_open()) out.close();
-    writeIndex();
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write chunk file");
 }
 
-std::vector<Record> ChunkedFileStrategy::readSequential() {
-    readIndex();
-    std::vector<Record> records;
-    records.reserve(recordOrder.size());
+void ChunkedFileStrategy::storeChunkDirect(int chunkId, const Record* records, size_t count,
+                                           IndexEntry* entries) {
+    size_t chunkBytes = 0;
+    for (size_t i = 0; i < count; ++i) chunkBytes += records[i].data.size();
     
-    std::ifstream currentFile;
-    int currentChunkId = -1;
+    // whole chunk goes out in one aligned write, zero padded to the block size
+    auto lease = bufferPool.acquire(alignUp(chunkBytes));
+    char* buf = lease->data();
     
-    constexpr size_t bufferSize = 1024 * 1024;
-    std::vector<char> iobuf(bufferSize);
+    size_t currentOffset = 0;
+    OpLap timer = lap(OpType::Write);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& record = records[i];
+        std::memcpy(buf + currentOffset, record.data.data(), record.data.size());
+        entries[i] = IndexEntry(chunkId, currentOffset, record.data.size(),
+                                recordChecksum(record.data.data(), record.data.size()));
+        currentOffset += record.data.size();
+        // the last record waits for the chunk write below
+        if (i + 1 < count) timer.mark();
+    }
     
-    for (int recordId : recordOrder) {
-        const auto& entry  = index[recordId];
-        int chunkId = entry.recordId; // chunkId stored here
-        
-        if (chunkId != currentChunkId) {
-            if (currentFile.is_open()) currentFile.close();
-            currentFile.open(getChunkFileName(chunkId), std::ios::binary);
-            if (!currentFile) throw std::runtime_error("Failed to open chunk file");
-            currentFile.rdbuf()->pubsetbuf(iobuf.data(), bufferSize);
-            currentChunkId = chunkId;
+    size_t padded = alignUp(chunkBytes);
+    std::memset(buf + chunkBytes, 0, padded - chunkBytes);
+    
+    DirectFile out(getChunkFileName(chunkId), DirectFile::Mode::Write);
+    out.writeAt(buf, padded, 0);
+    out.truncate(chunkBytes);  // keep the on-disk layout identical to buffered
+    paddingBytes += padded - chunkBytes;
+    if (count > 0) timer.mark();
+}
+
+void ChunkedFileStrategy::storeChunkCompressed(int chunkId, const Record* records, size_t count,
+                                               IndexEntry* entries) {
+    size_t chunkBytes = 0;
+    for (size_t i = 0; i < count; ++i) chunkBytes += records[i].data.size();
+    
+    auto raw = bufferPool.acquire(chunkBytes);
+    size_t currentOffset = 0;
+    OpLap timer = lap(OpType::Write);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& record = records[i];
+        std::memcpy(raw->data() + currentOffset, record.data.data(), record.data.size());
+        entries[i] = IndexEntry(chunkId, currentOffset, record.data.size(),
+                                recordChecksum(record.data.data(), record.data.size()));
+        currentOffset += record.data.size();
+        // compression and the write land on the last record
+        if (i + 1 < count) timer.mark();
+    }
+    
+    storeCompressed(getChunkFileName(chunkId), raw->data(), chunkBytes);
+    if (count > 0) timer.mark();
+}
+
+void ChunkedFileStrategy::storeCompressed(const std::string& path, const char* raw, size_t bytes) {
+    if (bytes > UINT32_MAX) throw std::runtime_error("chunk too large to compress");
+    size_t bound = std::max(codec->maxCompressedSize(bytes), bytes);
+    auto out = bufferPool.acquire(alignUp(sizeof(ChunkHeader) + bound));
+    char* payload = out->data() + sizeof(ChunkHeader);
+    
+    ChunkHeader header{};
+    header.magic = chunkMagic;
+    header.rawSize = static_cast<uint32_t>(bytes);
+    size_t stored = codec->compress(raw, bytes, payload);
+    if (stored < bytes) {
+        header.codec = static_cast<uint8_t>(codec->id());
+    } else {
+        // incompressible, not worth the decompression on every read
+        std::memcpy(payload, raw, bytes);
+        stored = bytes;
+        header.codec = static_cast<uint8_t>(CodecId::None);
+    }
+    header.storedSize = static_cast<uint32_t>(stored);
+    std::memcpy(out->data(), &header, sizeof(header));
+    size_t fileSize = sizeof(header) + stored;
+    
+    if (mode == IoMode::Direct) {
+        size_t padded = alignUp(fileSize);
+        std::memset(out->data() + fileSize, 0, padded - fileSize);
+        DirectFile file(path, DirectFile::Mode::Write);
+        file.writeAt(out->data(), padded, 0);
+        file.truncate(fileSize);
+        paddingBytes += padded - fileSize;
+        return;
+    }
+    
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open chunk file");
+    file.write(out->data(), fileSize);
+    file.close();
+    if (!file) throw std::runtime_error("Failed to write chunk file");
+}
+
+ChunkedFileStrategy::ChunkData ChunkedFileStrategy::decompressedChunk(int chunkId, size_t need) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (auto it = chunkCache.begin(); it != chunkCache.end(); ++it) {
+            // a tail chunk cached before it grew is no good for newer records
+            if (it->chunkId == chunkId && it->data->size() >= need) {
+                chunkCache.splice(chunkCache.begin(), chunkCache, it);
+                return it->data;
+            }
+        }
+    }
+    
+    // two workers can race to fill the same chunk, which only costs a
+    // duplicate decompress
+    auto file = bufferPool.acquire();
+    size_t fileSize = loadChunk(chunkId, *file);
+    
+    ChunkHeader header;
+    if (fileSize < sizeof(header)) throw std::runtime_error("chunk file too short");
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.codec == static_cast<uint8_t>(CodecId::None) && header.storedSize == 0)
+        header.rawSize = header.storedSize = static_cast<uint32_t>(fileSize - sizeof(header));
+    if (header.magic != chunkMagic || sizeof(header) + header.storedSize != fileSize)
+        throw std::runtime_error("bad chunk header in " + getChunkFileName(chunkId));
+    
+    auto data = std::make_shared<std::vector<char>>(header.rawSize);
+    const char* payload = file->data() + sizeof(header);
+    if (header.codec == static_cast<uint8_t>(CodecId::None)) {
+        if (header.storedSize != header.rawSize) throw std::runtime_error("bad stored chunk size");
+        std::memcpy(data->data(), payload, header.rawSize);
+    } else if (header.codec == static_cast<uint8_t>(codec->id())) {
+        codec->decompress(payload, header.storedSize, data->data(), header.rawSize);
+    } else {
+        throw std::runtime_error("chunk written with a different codec: " + getChunkFileName(chunkId));
+    }
+    
+    if (data->size() < need) throw std::runtime_error("index points past end of chunk");
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    chunkCache.remove_if([chunkId](const CachedChunk& c) { return c.chunkId == chunkId; });
+    chunkCache.push_front({chunkId, data});
+    if (chunkCache.size() > chunkCacheSize) chunkCache.pop_back();
+    return data;
+}
+
+void ChunkedFileStrategy::forgetChunk(int chunkId) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        chunkCache.remove_if([chunkId](const CachedChunk& c) { return c.chunkId == chunkId; });
+    }
+    fds.forget(getChunkFileName(chunkId));
+    forgetCached(getChunkFileName(chunkId));
+}
+
+void ChunkedFileStrategy::clearCache() {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        chunkCache.clear();
+    }
+    // chunk files are about to be rewritten or removed
+    fds.clear();
+}
+
+size_t ChunkedFileStrategy::loadChunk(int chunkId, AlignedBuffer& buf) {
+    if (mode == IoMode::Direct) {
+        DirectFile in(getChunkFileName(chunkId), DirectFile::Mode::Read);
+        size_t size = in.size();
+        in.readRange(buf, 0, size);  // offset 0, so the chunk starts at buf.data()
+        return size;
+    }
+    
+    auto file = fds.acquire(getChunkFileName(chunkId));
+    size_t size = file->size();
+    buf.reserve(size);
+    file->readAt(buf.data(), size, 0);
+    return size;
+}
+
+void ChunkedFileStrategy::startWrite(size_t numRecords) {
+    waitForCompaction();
+    // nothing reads while write() runs, so the snapshots can go now, and
+    // with them the chunk files compactions left for them - before any of
+    // those chunk ids get written again
+    current.reset();
+    epoch.reset();
+    indexLoaded = false;
+    indexChecksums = checksums;
+    paddingBytes = 0;
+    clearCache();
+    
+    // nothing from before survives a write: no log, no tail, no chunks
+    // left over from updates or compaction past the new ones
+    log.close();
+    fs::remove(logFile);
+    generation = 0;
+    tailChunk = -1;
+    tailRecords = 0;
+    deadBytes = 0;
+    size_t oldChunks = totalChunks;
+    totalChunks = (numRecords + recordsPerChunk - 1) / recordsPerChunk;
+    for (size_t i = 0; i < std::max(oldChunks, totalChunks); ++i) {
+        forgetCached(getChunkFileName(i));
+        if (i >= totalChunks) fs::remove(getChunkFileName(i));
+    }
+    chunkBytes.assign(totalChunks, 0);
+    chunkDead.assign(totalChunks, 0);
+}
+
+void ChunkedFileStrategy::write(const std::vector<Record>& records) {
+    startWrite(records.size());
+    std::lock_guard<std::mutex> writing(writeMutex);
+    std::vector<IndexEntry> entries(records.size());  // direct indexing by record ID
+    std::vector<int> order(records.size());
+    
+    // chunk boundaries are fixed up front, so chunks can go out in any order
+    // on any thread and the index still comes out the same. Every record has
+    // its own entries/order slot, so the workers never share a write.
+    forEachTask(totalChunks, [&](size_t chunk) {
+        size_t begin = chunk * recordsPerChunk;
+        size_t end = std::min(records.size(), begin + recordsPerChunk);
+        writeChunk(static_cast<int>(chunk), records.data() + begin, end - begin, begin, entries, order);
+    });
+    
+    for (const auto& entry : entries) chunkBytes[entry.recordId] += entry.size;
+    writeIndex(entries, order, generation, chunkBytes);
+    install(entries, order);
+    indexLoaded = true;
+}
+
+void ChunkedFileStrategy::writeStream(RecordStream& stream) {
+    size_t numRecords = stream.size();
+    startWrite(numRecords);
+    std::lock_guard<std::mutex> writing(writeMutex);
+    std::vector<IndexEntry> entries(numRecords);
+    std::vector<int> order(numRecords);
+    
+    // one chunk per worker in memory at a time. The records are copied out
+    // of the stream into reused buffers, generation is sequential anyway.
+    std::vector<Record> batch(std::min(numRecords, recordsPerChunk * numWorkers));
+    for (size_t first = 0; first < numRecords; first += batch.size()) {
+        size_t n = std::min(batch.size(), numRecords - first);
+        for (size_t i = 0; i < n; ++i) {
+            const Record* record = stream.next();
+            if (!record) throw std::runtime_error("record stream ended early");
+            batch[i].id = record->id;
+            batch[i].data.assign(record->data.begin(), record->data.end());
         }
         
-        // records within a chunk are already sequential, no seek needed
-        Record record(recordId, entry.size);
-        currentFile.read(record.data.data(), entry.size);
-        records.push_back(std::move(record));
+        size_t chunks = (n + recordsPerChunk - 1) / recordsPerChunk;
+        forEachTask(chunks, [&](size_t c) {
+            size_t begin = c * recordsPerChunk;
+            size_t end = std::min(n, begin + recordsPerChunk);
+            writeChunk(static_cast<int>((first + begin) / recordsPerChunk), batch.data() + begin,
+                       end - begin, first + begin, entries, order);
+        });
     }
     
+    for (const auto& entry : entries) chunkBytes[entry.recordId] += entry.size;
+    writeIndex(entries, order, generation, chunkBytes);
+    install(entries, order);
+    indexLoaded = true;
+}
+
+std::vector<Record> ChunkedFileStrategy::readSequential() {
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    const auto& order = snap->recordOrder;
+    std::vector<Record> records(order.size());
+    auto runs = chunkRuns(*snap);
+    
+    // each worker fills its own slice of the result, so order is preserved
+    forEachTask(runs.size(), [&](size_t r) {
+        const auto& run = runs[r];
+        OpLap timer = lap(OpType::SeqRead);
+        
+        if (codec) {
+            // the run's last record ends furthest into the chunk
+            const auto& last = entries[order[run.end - 1]];
+            ChunkData chunk = decompressedChunk(run.chunkId, last.offset + last.size);
+            for (size_t pos = run.begin; pos < run.end; ++pos) {
+                int recordId = order[pos];
+                const auto& entry = entries[recordId];
+                if (entry.recordId == IndexFile::removed) continue;
+                if (entry.offset + entry.size > chunk->size())
+                    throw std::runtime_error("index points past end of chunk");
+                verifyChecksum(entry, recordId, chunk->data() + entry.offset);
+                Record record(recordId, entry.size);
+                std::memcpy(record.data.data(), chunk->data() + entry.offset, entry.size);
+                records[pos] = std::move(record);
+                timer.mark();
+            }
+            return;
+        }
+        
+        if (mode == IoMode::Direct) {
+            auto lease = bufferPool.acquire();
+            size_t chunkSize = loadChunk(run.chunkId, *lease);
+            for (size_t pos = run.begin; pos < run.end; ++pos) {
+                int recordId = order[pos];
+                const auto& entry = entries[recordId];
+                if (entry.recordId == IndexFile::removed) continue;
+                if (entry.offset + entry.size > chunkSize)
+                    throw std::runtime_error("index points past end of chunk");
+                verifyChecksum(entry, recordId, lease->data() + entry.offset);
+                Record record(recordId, entry.size);
+                std::memcpy(record.data.data(), lease->data() + entry.offset, entry.size);
+                records[pos] = std::move(record);
+                timer.mark();
+            }
+            return;
+        }
+        
+        // records within a run are contiguous in the chunk, so one pread
+        // covers the lot
+        const auto& first = entries[order[run.begin]];
+        const auto& last = entries[order[run.end - 1]];
+        size_t start = first.offset;
+        size_t bytes = last.offset + last.size - start;
+        auto file = fds.acquire(getChunkFileName(run.chunkId));
+        auto lease = bufferPool.acquire(bytes);
+        file->readAt(lease->data(), bytes, start);
+        
+        for (size_t pos = run.begin; pos < run.end; ++pos) {
+            int recordId = order[pos];
+            const auto& entry = entries[recordId];
+            if (entry.recordId == IndexFile::removed) continue;
+            Record record(recordId, entry.size);
+            std::memcpy(record.data.data(), lease->data() + (entry.offset - start), entry.size);
+            verifyChecksum(entry, recordId, record.data.data());
+            records[pos] = std::move(record);
+            timer.mark();
+        }
+    });
+    
+    // removed records left their slots empty
+    size_t slot = 0;
+    for (size_t pos = 0; pos < order.size(); ++pos) {
+        if (entries[order[pos]].recordId == IndexFile::removed) continue;
+        if (slot != pos) records[slot] = std::move(records[pos]);
+        ++slot;
+    }
+    records.resize(slot);
     return records;
 }
 
 std::vector<Record> ChunkedFileStrategy::readRandom(const std::vector<int>& indices) {
-    readIndex();
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    for (int idx : indices) liveEntry(entries, idx);
     
     // sort by (chunk, offset) to minimize file switches
     std::vector<std::pair<int, size_t>> sorted;
@@ -100,69 +475,604 @@ std::vector<Record> ChunkedFileStrategy::readRandom(const std::vector<int>& indi
         sorted.emplace_back(indices[i], i);
     
     std::sort(sorted.begin(), sorted.end(),
-              [this](const auto& a, const auto& b) {
-                  const auto& ea = index[a.first];
-                  const auto& eb = index[b.first];
+              [&entries](const auto& a, const auto& b) {
+                  const auto& ea = entries[a.first];
+                  const auto& eb = entries[b.first];
                   if (ea.recordId != eb.recordId) return ea.recordId < eb.recordId;
                   return ea.offset < eb.offset;
               });
     
+    // one task per chunk touched
+    std::vector<size_t> groupStart;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i == 0 || entries[sorted[i].first].recordId != entries[sorted[i - 1].first].recordId)
+            groupStart.push_back(i);
+    }
+    groupStart.push_back(sorted.size());
+    
     std::vector<Record> records(indices.size());
-    std::ifstream currentFile;
+    forEachTask(groupStart.size() - 1, [&](size_t g) {
+        int chunkId = entries[sorted[groupStart[g]].first].recordId;
+        OpLap timer = lap(OpType::RandRead);
+        
+        if (codec) {
+            const auto& last = entries[sorted[groupStart[g + 1] - 1].first];
+            ChunkData chunk = decompressedChunk(chunkId, last.offset + last.size);
+            for (size_t i = groupStart[g]; i < groupStart[g + 1]; ++i) {
+                const auto& [idx, origPos] = sorted[i];
+                const auto& entry = entries[idx];
+                verifyChecksum(entry, idx, chunk->data() + entry.offset);
+                Record record(idx, entry.size);
+                std::memcpy(record.data.data(), chunk->data() + entry.offset, entry.size);
+                records[origPos] = std::move(record);
+                timer.mark();
+            }
+            return;
+        }
+        
+        if (mode == IoMode::Direct) {
+            DirectFile in(getChunkFileName(chunkId), DirectFile::Mode::Read);
+            auto page = bufferPool.acquire();
+            for (size_t i = groupStart[g]; i < groupStart[g + 1]; ++i) {
+                const auto& [idx, origPos] = sorted[i];
+                const auto& entry = entries[idx];
+                const char* src = in.readRange(*page, entry.offset, entry.size);
+                verifyChecksum(entry, idx, src);
+                Record record(idx, entry.size);
+                std::memcpy(record.data.data(), src, entry.size);
+                records[origPos] = std::move(record);
+                timer.mark();
+            }
+            return;
+        }
+        
+        std::string chunkFile = getChunkFileName(chunkId);
+        if (!blockCache && coalesce) {
+            std::vector<ReadPlanner::Request> requests;
+            requests.reserve(groupStart[g + 1] - groupStart[g]);
+            for (size_t i = groupStart[g]; i < groupStart[g + 1]; ++i) {
+                const auto& [idx, origPos] = sorted[i];
+                records[origPos] = Record(idx, entries[idx].size);
+                requests.push_back({entries[idx].offset, entries[idx].size, records[origPos].data.data()});
+            }
+            auto file = fds.acquire(chunkFile);
+            ReadPlanner::read(file->fd(), chunkFile, requests, coalesceGap,
+                              [&](const ReadPlanner::Span& span) { timer.markBatch(span.count); });
+            for (size_t i = groupStart[g]; i < groupStart[g + 1]; ++i) {
+                const auto& [idx, origPos] = sorted[i];
+                verifyChecksum(entries[idx], idx, records[origPos].data.data());
+            }
+            return;
+        }
+        
+        // the stream is only for the block cache's misses
+        std::ifstream in;
+        FdCache::Handle file;
+        if (!blockCache) file = fds.acquire(chunkFile);
+        
+        for (size_t i = groupStart[g]; i < groupStart[g + 1]; ++i) {
+            const auto& [idx, origPos] = sorted[i];
+            const auto& entry = entries[idx];
+            Record record(idx, entry.size);
+            if (blockCache) {
+                // chunk file only gets opened if something misses
+                cachedRead(chunkFile, in, entry.offset, entry.size, record.data.data());
+            } else {
+                file->readAt(record.data.data(), entry.size, entry.offset);
+            }
+            verifyChecksum(entry, idx, record.data.data());
+            records[origPos] = std::move(record);
+            timer.mark();
+        }
+    });
+    
+    return records;
+}
+
+void ChunkedFileStrategy::scanSequential(const RecordVisitor& visit) {
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    const auto& order = snap->recordOrder;
+    
+    // chunks are small enough to pull in whole, one read per chunk file
+    auto chunkData = bufferPool.acquire();
+    ChunkData decompressed;
+    const char* chunkBytes = nullptr;
+    size_t chunkSize = 0;
     int currentChunkId = -1;
     
-    for (const auto& [idx, origPos] : sorted) {
-        const auto& entry = index[idx];
+    for (int recordId : order) {
+        const auto& entry = entries[recordId];
+        int chunkId = entry.recordId;
+        if (chunkId == IndexFile::removed) continue;
+        
+        // a cached tail chunk can be short of what this snapshot points at
+        if (chunkId != currentChunkId || entry.offset + entry.size > chunkSize) {
+            if (codec) {
+                decompressed = decompressedChunk(chunkId, entry.offset + entry.size);
+                chunkBytes = decompressed->data();
+                chunkSize = decompressed->size();
+            } else {
+                chunkSize = loadChunk(chunkId, *chunkData);
+                chunkBytes = chunkData->data();
+            }
+            currentChunkId = chunkId;
+        }
+        
+        if (entry.offset + entry.size > chunkSize)
+            throw std::runtime_error("index points past end of chunk");
+        verifyChecksum(entry, recordId, chunkBytes + entry.offset);
+        visit(RecordView(recordId, chunkBytes + entry.offset, entry.size));
+    }
+}
+
+void ChunkedFileStrategy::scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) {
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    for (int idx : indices) liveEntry(entries, idx);
+    
+    std::vector<int> sorted(indices);
+    std::sort(sorted.begin(), sorted.end(),
+              [&entries](int a, int b) {
+                  const auto& ea = entries[a];
+                  const auto& eb = entries[b];
+                  if (ea.recordId != eb.recordId) return ea.recordId < eb.recordId;
+                  return ea.offset < eb.offset;
+              });
+    
+    if (codec) {
+        ChunkData chunk;
+        int currentChunkId = -1;
+        for (int idx : sorted) {
+            const auto& entry = entries[idx];
+            if (entry.recordId != currentChunkId || entry.offset + entry.size > chunk->size()) {
+                chunk = decompressedChunk(entry.recordId, entry.offset + entry.size);
+                currentChunkId = entry.recordId;
+            }
+            verifyChecksum(entry, idx, chunk->data() + entry.offset);
+            visit(RecordView(idx, chunk->data() + entry.offset, entry.size));
+        }
+        return;
+    }
+    
+    if (mode == IoMode::Direct) {
+        std::unique_ptr<DirectFile> currentFile;
+        int currentChunkId = -1;
+        auto page = bufferPool.acquire();
+        
+        for (int idx : sorted) {
+            const auto& entry = entries[idx];
+            if (entry.recordId != currentChunkId) {
+                currentFile = std::make_unique<DirectFile>(getChunkFileName(entry.recordId),
+                                                           DirectFile::Mode::Read);
+                currentChunkId = entry.recordId;
+            }
+            const char* data = currentFile->readRange(*page, entry.offset, entry.size);
+            verifyChecksum(entry, idx, data);
+            visit(RecordView(idx, data, entry.size));
+        }
+        return;
+    }
+    
+    if (!blockCache && coalesce) {
+        // sorted is grouped by chunk already, one planned read per chunk
+        std::vector<char> batch;
+        std::vector<size_t> at;
+        std::vector<ReadPlanner::Request> requests;
+        size_t start = 0;
+        while (start < sorted.size()) {
+            int chunkId = entries[sorted[start]].recordId;
+            size_t end = start;
+            at.clear();
+            size_t total = 0;
+            while (end < sorted.size() && entries[sorted[end]].recordId == chunkId) {
+                at.push_back(total);
+                total += entries[sorted[end]].size;
+                ++end;
+            }
+            if (batch.size() < total) batch.resize(total);
+            
+            requests.clear();
+            for (size_t i = start; i < end; ++i) {
+                const auto& entry = entries[sorted[i]];
+                requests.push_back({entry.offset, entry.size, batch.data() + at[i - start]});
+            }
+            std::string chunkFile = getChunkFileName(chunkId);
+            ReadPlanner::read(fds.acquire(chunkFile)->fd(), chunkFile, requests, coalesceGap);
+            
+            for (size_t i = start; i < end; ++i) {
+                const auto& entry = entries[sorted[i]];
+                const char* data = batch.data() + at[i - start];
+                verifyChecksum(entry, sorted[i], data);
+                visit(RecordView(sorted[i], data, entry.size));
+            }
+            start = end;
+        }
+        return;
+    }
+    
+    std::ifstream currentFile;  // block cache misses only
+    FdCache::Handle file;
+    std::string chunkFile;
+    int currentChunkId = -1;
+    std::vector<char> scratch;
+    
+    for (int idx : sorted) {
+        const auto& entry = entries[idx];
         int chunkId = entry.recordId;
         
         if (chunkId != currentChunkId) {
             if (currentFile.is_open()) currentFile.close();
-            currentFile.open(getChunkFileName(chunkId), std::ios::binary);
-            if (!currentFile) throw std::runtime_error("Failed to open chunk file");
+            chunkFile = getChunkFileName(chunkId);
+            if (!blockCache) file = fds.acquire(chunkFile);
             currentChunkId = chunkId;
         }
         
-        Record record(idx, entry.size);
-        currentFile.seekg(entry.offset);
-        currentFile.read(record.data.data(), entry.size);
-        records[origPos] = std::move(record);
+        if (scratch.size() < entry.size) scratch.resize(entry.size);
+        if (blockCache) {
+            cachedRead(chunkFile, currentFile, entry.offset, entry.size, scratch.data());
+        } else {
+            file->readAt(scratch.data(), entry.size, entry.offset);
+        }
+        verifyChecksum(entry, idx, scratch.data());
+        visit(RecordView(idx, scratch.data(), entry.size));
     }
-    
-    return records;
 }
 
-void ChunkedFileStrategy::writeIndex() {
-    std::ofstream out(indexFile, std::ios::binary);
-    if (!out) throw std::runtime_error("Failed to open index file");
+Record ChunkedFileStrategy::readOne(int id) {
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    const auto& entry = liveEntry(entries, id);
+    Record record(id, entry.size);
     
-    size_t count = recordOrder.size();
-    out.write(reinterpret_cast<const char*>(&count),       sizeof(count));
-    out.write(reinterpret_cast<const char*>(&totalChunks), sizeof(totalChunks));
+    if (codec) {
+        ChunkData chunk = decompressedChunk(entry.recordId, entry.offset + entry.size);
+        std::memcpy(record.data.data(), chunk->data() + entry.offset, entry.size);
+    } else if (mode == IoMode::Direct) {
+        DirectFile in(getChunkFileName(entry.recordId), DirectFile::Mode::Read);
+        auto page = bufferPool.acquire();
+        std::memcpy(record.data.data(), in.readRange(*page, entry.offset, entry.size), entry.size);
+    } else if (blockCache) {
+        std::ifstream in;
+        cachedRead(getChunkFileName(entry.recordId), in, entry.offset, entry.size, record.data.data());
+    } else {
+        fds.acquire(getChunkFileName(entry.recordId))->readAt(record.data.data(), entry.size, entry.offset);
+    }
     
-    out.write(reinterpret_cast<const char*>(recordOrder.data()), count * sizeof(int));
-    out.write(reinterpret_cast<const char*>(index.data()),       index.size() * sizeof(IndexEntry));
+    verifyChecksum(entry, id, record.data.data());
+    return record;
+}
+
+void ChunkedFileStrategy::writeIndex(const std::vector<IndexEntry>& entries, const std::vector<int>& order,
+                                     uint64_t gen, const std::vector<size_t>& bytes) {
+    // keys are chunk ids; aux is the chunk count, the generation, then the
+    // bytes in each chunk
+    IndexFile::Contents contents;
+    contents.entries = &entries;
+    contents.checksums = indexChecksums;
+    contents.order = &order;
+    contents.aux = {bytes.size(), gen};
+    contents.aux.insert(contents.aux.end(), bytes.begin(), bytes.end());
+    IndexFile::write(indexFile, contents);
+}
+
+void ChunkedFileStrategy::install(const std::vector<IndexEntry>& entries, const std::vector<int>& order) {
+    index.assign(entries);
+    recordOrder.assign(order);
+    if (!epoch) epoch = std::make_shared<SnapshotEpoch>();
+    publish();
 }
 
 void ChunkedFileStrategy::readIndex() {
-    std::ifstream in(indexFile, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open index file");
+    IndexFile file(indexFile);
+    if (!file.hasOrder() || file.auxCount() < 1)
+        throw std::runtime_error("not a chunked index: " + indexFile);
+    std::vector<IndexEntry> entries;
+    std::vector<int> order;
+    file.decode(entries);
+    file.decodeOrder(order);
+    indexChecksums = file.hasChecksums();
+    totalChunks = static_cast<size_t>(file.aux(0));
     
-    size_t count;
-    in.read(reinterpret_cast<char*>(&count),       sizeof(count));
-    in.read(reinterpret_cast<char*>(&totalChunks), sizeof(totalChunks));
+    chunkBytes.assign(totalChunks, 0);
+    if (file.auxCount() == 2 + totalChunks) {
+        generation = file.aux(1);
+        for (size_t c = 0; c < totalChunks; ++c) chunkBytes[c] = static_cast<size_t>(file.aux(2 + c));
+    } else if (file.auxCount() == 1) {
+        // written before updates existed: every byte is live
+        generation = 0;
+        for (const auto& entry : entries) chunkBytes[entry.recordId] += entry.size;
+    } else {
+        throw std::runtime_error("not a chunked index: " + indexFile);
+    }
     
-    recordOrder.resize(count);
-    in.read(reinterpret_cast<char*>(recordOrder.data()), count * sizeof(int));
+    // no log until the first update
+    std::vector<IndexLog::Redirect> redirects;
+    if (fs::exists(logFile)) redirects = log.open(logFile, generation);
+    for (const auto& r : redirects) {
+        // new ids are read in id order, like growIndex()
+        while (entries.size() <= static_cast<size_t>(r.id)) {
+            order.push_back(static_cast<int>(entries.size()));
+            entries.emplace_back(IndexFile::removed, 0, 0);
+        }
+        entries[r.id] = r.entry;
+        if (r.entry.recordId == IndexFile::removed) continue;
+        // tail chunks only exist in the log so far
+        size_t chunk = static_cast<size_t>(r.entry.recordId);
+        if (chunk >= chunkBytes.size()) chunkBytes.resize(chunk + 1, 0);
+        chunkBytes[chunk] = std::max(chunkBytes[chunk], r.entry.offset + r.entry.size);
+    }
+    totalChunks = chunkBytes.size();
     
-    index.resize(count);
-    in.read(reinterpret_cast<char*>(index.data()), count * sizeof(IndexEntry));
+    // what the index doesn't point at any more is dead
+    chunkDead = chunkBytes;
+    for (const auto& entry : entries) {
+        if (entry.recordId != IndexFile::removed) chunkDead[entry.recordId] -= entry.size;
+    }
+    size_t dead = 0;
+    for (size_t bytes : chunkDead) dead += bytes;
+    deadBytes = dead;
+    // updates start a tail chunk of their own
+    tailChunk = -1;
+    tailRecords = 0;
+    install(entries, order);
+}
+
+void ChunkedFileStrategy::loadIndex() {
+    if (indexLoaded.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (indexLoaded.load(std::memory_order_relaxed)) return;
+    readIndex();
+    indexLoaded.store(true, std::memory_order_release);
+}
+
+void ChunkedFileStrategy::publish() {
+    auto snap = std::make_unique<Snapshot>();
+    snap->index = index.share();
+    snap->recordOrder = recordOrder.share();
+    snap->epoch = epoch;
+    current.publish(std::move(snap));
+}
+
+SnapshotCell<ChunkedFileStrategy::Snapshot>::Reader ChunkedFileStrategy::snapshot() {
+    loadIndex();
+    return current.read();
+}
+
+IndexEntry ChunkedFileStrategy::appendToTail(const std::vector<char>& data) {
+    if (tailChunk < 0 || tailRecords >= recordsPerChunk) {
+        tailChunk = static_cast<int>(chunkBytes.size());
+        tailRecords = 0;
+        chunkBytes.push_back(0);
+        chunkDead.push_back(0);
+        totalChunks = chunkBytes.size();
+    }
+    
+    std::string path = getChunkFileName(tailChunk);
+    size_t offset = chunkBytes[tailChunk];
+    // a compressed chunk is one block that would have to be redone on every
+    // update, so with a codec the tail starts with an open-ended raw header
+    // and gets plain appends too. Readers loading it meanwhile see a shorter
+    // chunk, which is all the index they hold points at.
+    std::ofstream out(path, std::ios::binary | (offset == 0 ? std::ios::trunc : std::ios::app));
+    if (!out) throw std::runtime_error("Failed to open chunk file");
+    if (codec && offset == 0) {
+        ChunkHeader header{};
+        header.magic = chunkMagic;
+        header.codec = static_cast<uint8_t>(CodecId::None);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write chunk file");
+    
+    chunkBytes[tailChunk] += data.size();
+    ++tailRecords;
+    IndexEntry entry(tailChunk, offset, data.size(), recordChecksum(data.data(), data.size()));
+    if (codec && tailRecords == recordsPerChunk) sealTail();
+    return entry;
+}
+
+void ChunkedFileStrategy::sealTail() {
+    // same contents either way, so readers can load the old file or the new one
+    ChunkData raw = decompressedChunk(tailChunk, chunkBytes[tailChunk]);
+    std::string path = getChunkFileName(tailChunk);
+    storeCompressed(path + ".tmp", raw->data(), raw->size());
+    fs::rename(path + ".tmp", path);
+    fds.forget(path);
+}
+
+void ChunkedFileStrategy::growIndex(size_t size) {
+    // new ids are read in id order
+    while (index.size() < size) {
+        recordOrder.push_back(static_cast<int>(index.size()));
+        index.push_back(IndexEntry(IndexFile::removed, 0, 0));
+    }
+}
+
+void ChunkedFileStrategy::update(int id, const std::vector<char>& data) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    liveEntry(index, id);
+    commit({{id, appendToTail(data)}});
+}
+
+void ChunkedFileStrategy::remove(int id) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    const auto& old = liveEntry(index, id);
+    commit({{id, IndexEntry(IndexFile::removed, old.offset, 0)}});
+}
+
+void ChunkedFileStrategy::append(const std::vector<Record>& records) {
+    // nothing to append to yet
+    if (!indexLoaded && !fs::exists(indexFile)) write({});
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    for (const auto& record : records) {
+        if (record.id < 0) throw std::invalid_argument("negative record id " + std::to_string(record.id));
+    }
+    
+    // top up the tail, whole chunks go out as chunks of their own (on the
+    // workers, compressed right away) and what's left starts the next tail
+    std::vector<IndexLog::Redirect> batch(records.size());
+    size_t i = 0;
+    for (; i < records.size() && tailChunk >= 0 && tailRecords < recordsPerChunk; ++i)
+        batch[i] = {records[i].id, appendToTail(records[i].data)};
+    
+    size_t full = (records.size() - i) / recordsPerChunk;
+    if (full > 0) {
+        size_t firstNew = chunkBytes.size();
+        std::vector<IndexEntry> entries(full * recordsPerChunk);
+        forEachTask(full, [&](size_t c) {
+            storeChunk(static_cast<int>(firstNew + c), records.data() + i + c * recordsPerChunk,
+                       recordsPerChunk, entries.data() + c * recordsPerChunk);
+        });
+        chunkBytes.resize(firstNew + full, 0);
+        chunkDead.resize(firstNew + full, 0);
+        totalChunks = chunkBytes.size();
+        for (size_t k = 0; k < entries.size(); ++k) {
+            batch[i + k] = {records[i + k].id, entries[k]};
+            chunkBytes[entries[k].recordId] += entries[k].size;
+        }
+        i += entries.size();
+    }
+    
+    for (; i < records.size(); ++i) batch[i] = {records[i].id, appendToTail(records[i].data)};
+    commit(batch);
+}
+
+void ChunkedFileStrategy::commit(const std::vector<IndexLog::Redirect>& batch) {
+    // the log is the commit point, the data is already in the chunks
+    if (!log.isOpen()) log.open(logFile, generation);
+    log.append(batch);
+    
+    // caches holding a tail chunk from before it grew notice by themselves
+    bool compactNow = false;
+    for (const auto& r : batch) {
+        growIndex(r.id + 1);
+        IndexEntry old = index[r.id];
+        index.set(r.id, r.entry);
+        if (old.recordId == IndexFile::removed) continue;
+        chunkDead[old.recordId] += old.size;
+        deadBytes += old.size;
+        if (autoCompactRatio > 0 && old.recordId != tailChunk &&
+            chunkDead[old.recordId] > autoCompactRatio * chunkBytes[old.recordId])
+            compactNow = true;
+    }
+    publish();
+    foldLog();
+    if (compactNow) compactInBackground();
+}
+
+void ChunkedFileStrategy::foldLog() {
+    // by now replaying the log on load costs more than reading the index,
+    // and rewriting the index is paid for by as many appends as it has entries
+    if (log.size() < std::max(index.size(), minFoldEntries)) return;
+    writeIndex(index.toVector(), recordOrder.toVector(), generation + 1, chunkBytes);
+    log.open(logFile, generation + 1);
+    ++generation;
+}
+
+size_t ChunkedFileStrategy::compact(double garbageRatio) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    
+    // chunks past the threshold; the tail is still being filled
+    std::vector<char> victim(chunkBytes.size(), 0);
+    size_t reclaimed = 0;
+    for (size_t c = 0; c < chunkBytes.size(); ++c) {
+        if (static_cast<int>(c) == tailChunk || chunkBytes[c] == 0) continue;
+        if (chunkDead[c] > garbageRatio * chunkBytes[c]) {
+            victim[c] = 1;
+            reclaimed += chunkDead[c];
+        }
+    }
+    if (reclaimed == 0) return 0;
+    
+    // their live records, in sequential read order, into fresh chunks.
+    // Readers carry on meanwhile with the current snapshot.
+    std::vector<int> ids;
+    for (int id : recordOrder) {
+        const auto& entry = index[id];
+        if (entry.recordId != IndexFile::removed && victim[entry.recordId]) ids.push_back(id);
+    }
+    std::vector<Record> live(ids.size());
+    std::vector<size_t> slot(index.size());
+    for (size_t i = 0; i < ids.size(); ++i) slot[ids[i]] = i;
+    scanRandom(ids, [&](const RecordView& view) {
+        Record& record = live[slot[view.id]];
+        record.id = view.id;
+        record.data.assign(view.data, view.data + view.size);
+    });
+    
+    size_t firstNew = chunkBytes.size();
+    size_t newChunks = (live.size() + recordsPerChunk - 1) / recordsPerChunk;
+    std::vector<IndexEntry> entries(live.size());
+    forEachTask(newChunks, [&](size_t c) {
+        size_t begin = c * recordsPerChunk;
+        size_t end = std::min(live.size(), begin + recordsPerChunk);
+        storeChunk(static_cast<int>(firstNew + c), live.data() + begin, end - begin, entries.data() + begin);
+    });
+    
+    std::vector<IndexEntry> compacted = index.toVector();
+    std::vector<size_t> bytes(chunkBytes);
+    bytes.resize(firstNew + newChunks, 0);
+    for (size_t c = 0; c < firstNew; ++c) {
+        if (victim[c]) bytes[c] = 0;
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+        compacted[ids[i]] = entries[i];
+        bytes[entries[i].recordId] += entries[i].size;
+    }
+    
+    // publishing the index is the switch-over; the old log is stale after it
+    writeIndex(compacted, recordOrder.toVector(), generation + 1, bytes);
+    log.open(logFile, generation + 1);
+    // only the moved entries change, the other pages stay shared
+    for (size_t i = 0; i < ids.size(); ++i) index.set(ids[i], entries[i]);
+    auto oldEpoch = epoch;
+    epoch = SnapshotEpoch::advance(oldEpoch);
+    publish();
+    
+    ++generation;
+    chunkBytes = std::move(bytes);
+    chunkDead.resize(chunkBytes.size(), 0);
+    for (size_t c = 0; c < firstNew; ++c) {
+        if (!victim[c]) continue;
+        chunkDead[c] = 0;
+        // readers still on older snapshots keep the file until they're done
+        oldEpoch->retire(getChunkFileName(static_cast<int>(c)));
+        forgetChunk(static_cast<int>(c));
+    }
+    totalChunks = chunkBytes.size();
+    deadBytes -= reclaimed;
+    ++compactions;
+    return reclaimed;
 }
 
 void ChunkedFileStrategy::cleanUp() {
+    waitForCompaction();
+    // no readers now; the last snapshot takes the retired chunks with it
+    current.reset();
+    epoch.reset();
+    clearCache();
+    indexLoaded = false;
+    index.clear();
+    recordOrder.clear();
+    log.close();
     for (size_t i = 0; i < totalChunks; ++i) {
+        forgetCached(getChunkFileName(i));
         fs::remove(getChunkFileName(i));
     }
     fs::remove(indexFile);
+    fs::remove(logFile);
+    generation = 0;
+    tailChunk = -1;
+    tailRecords = 0;
+    chunkBytes.clear();
+    chunkDead.clear();
+    deadBytes = 0;
 }
 
 size_t ChunkedFileStrategy::getDiskSpaceUsed() const {
@@ -178,10 +1088,23 @@ size_t ChunkedFileStrategy::getDiskSpaceUsed() const {
     if (fs::exists(indexFile)) {
         total += fs::file_size(indexFile);
     }
+    if (fs::exists(logFile)) {
+        total += fs::file_size(logFile);
+    }
     
     return total;
 }
 
+FileHandleStats ChunkedFileStrategy::getFileHandleStats() const {
+    auto stats = fds.stats();
+    return {stats.opens, stats.reuses, stats.evictions};
+}
+
 size_t ChunkedFileStrategy::getNumFiles() const {
-    return totalChunks + 1; // chunks + index
+    // chunks that compaction hasn't emptied + index (+ log)
+    size_t files = fs::exists(logFile) ? 2 : 1;
+    for (size_t c = 0; c < totalChunks; ++c) {
+        if (c >= chunkBytes.size() || chunkBytes[c] > 0) ++files;
+    }
+    return files;
 }
@@ -1,30 +1,178 @@
 #pragma once
 #include "StorageStrategy.h"
+#include "AlignedBuffer.h"
+#include "Codec.h"
+#include "FdCache.h"
+#include "IndexFile.h"
+#include "Snapshot.h"
 #include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <atomic>
+#include <string>
+#include <cstdint>
 
-// Splits records into fixed-size chunks, each in its own file.
+class WorkerPool;
+
+// Splits records into fixed-size chunks, each in its own file. With more
+// than one worker, chunks are written and read concurrently. Supports the
+// Buffered and Direct io modes.
+//
+// With a codec, every chunk file is a small header followed by the whole
+// chunk compressed as one block (or stored raw if it didn't shrink). Index
+// offsets are still into the uncompressed chunk. Decompressed chunks are
+// kept in a small LRU so random reads that land in the same chunk only pay
+// for decompression once.
+//
+// Buffered reads go through pread on descriptors kept in an FdCache, so
+// hopping between chunks doesn't reopen files every time. The index is
+// read on first use and kept in memory until the next write.
+//
+// Reads don't lock the index: they run against an immutable Snapshot of it
+// and the read order, published through a SnapshotCell after every change.
+// Chunk files a compaction empties go once no reader can see a snapshot
+// that refers to them.
+//
+// update() appends the new bytes to a tail chunk (a new chunk id, filled up
+// to recordsPerChunk records; with a codec the tail is stored raw behind an
+// open-ended header, to be compressed by compaction later) and logs the new
+// index entry to an IndexLog. compact() moves the live records of chunks
+// past the garbage threshold into fresh chunks and retires the old files.
+// Index aux is [chunk count, generation, bytes per chunk...].
 class ChunkedFileStrategy : public StorageStrategy {
 public:
-    ChunkedFileStrategy(const std::string& dir, size_t recordsPerChunk = 1000);
+    ChunkedFileStrategy(const std::string& dir, size_t recordsPerChunk = 1000,
+                        size_t numWorkers = 1, IoMode mode = IoMode::Buffered,
+                        CodecId codecId = CodecId::None);
+    ~ChunkedFileStrategy() override;
     
     void write(const std::vector<Record>& records) override;
+    void writeStream(RecordStream& stream) override;
+    bool supportsStreaming() const override { return true; }
+    bool storesChecksums() const override { return true; }
     std::vector<Record> readSequential() override;
     std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void scanSequential(const RecordVisitor& visit) override;
+    void scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) override;
+    Record readOne(int id) override;
+    void update(int id, const std::vector<char>& data) override;
+    void remove(int id) override;
+    void append(const std::vector<Record>& records) override;
+    bool supportsUpdates() const override { return true; }
+    size_t getDeadBytes() const override { return deadBytes; }
+    size_t compact(double garbageRatio) override;
+    bool supportsCompaction() const override { return true; }
     void cleanUp() override;
-    std::string getName() const override { return "Chunked"; }
+    std::string getName() const override;
     
     size_t getDiskSpaceUsed() const override;
     size_t getNumFiles() const override;
+    size_t getPaddingBytes() const override { return paddingBytes; }
+    FileHandleStats getFileHandleStats() const override;
     
 private:
+    // consecutive positions in recordOrder that live in the same chunk
+    struct ChunkRun {
+        int chunkId;
+        size_t begin;
+        size_t end;
+    };
+    
+    using ChunkData = std::shared_ptr<const std::vector<char>>;
+    
+    struct CachedChunk {
+        int chunkId;
+        ChunkData data;
+    };
+    
+    // what a reader sees, never changed once published
+    struct Snapshot {
+        CowVector<IndexEntry> index;
+        CowVector<int> recordOrder;
+        std::shared_ptr<SnapshotEpoch> epoch;
+    };
+    
     size_t recordsPerChunk;
+    size_t numWorkers;
+    IoMode mode;
+    std::unique_ptr<Codec> codec;      // null when chunks are stored raw
+    std::unique_ptr<WorkerPool> pool;  // only when numWorkers > 1
+    AlignedBufferPool bufferPool;
+    std::atomic<size_t> paddingBytes{0};
     size_t totalChunks = 0;
     std::string indexFile;
+    std::string logFile;
+    
+    SnapshotCell<Snapshot> current;
+    std::mutex indexMutex;
+    std::atomic<bool> indexLoaded{false};
+    
+    // The writer's side, under writeMutex: what the next snapshot is made of
+    // and the bookkeeping behind it.
+    std::mutex writeMutex;
+    CowVector<IndexEntry> index;
+    CowVector<int> recordOrder;  // for sequential reads
+    std::shared_ptr<SnapshotEpoch> epoch;
+    IndexLog log;
+    uint64_t generation = 0;
+    std::vector<size_t> chunkBytes;  // uncompressed bytes per chunk, 0 once compacted away
+    std::vector<size_t> chunkDead;   // of those, no longer pointed at
+    std::atomic<size_t> deadBytes{0};
+    int tailChunk = -1;              // where update() appends, -1 until the first one
+    size_t tailRecords = 0;
+    
+    std::mutex cacheMutex;
+    std::list<CachedChunk> chunkCache;  // most recently used first
     
-    std::vector<IndexEntry> index;
-    std::vector<int> recordOrder; // for sequential reads
+    // chunk files stay open across reads; emptied whenever they're rewritten
+    FdCache fds{256};
     
     std::string getChunkFileName(int chunkId) const;
-    void writeIndex();
+    // through the pool, serially without one or on the background compactor
+    void forEachTask(size_t count, const std::function<void(size_t)>& task);
+    std::vector<ChunkRun> chunkRuns(const Snapshot& snap) const;
+    // resets everything write() and writeStream() start over
+    void startWrite(size_t numRecords);
+    // records[0..count) is chunk chunkId, starting at position firstPos of
+    // order; entries is indexed by record id
+    void writeChunk(int chunkId, const Record* records, size_t count, size_t firstPos,
+                    std::vector<IndexEntry>& entries, std::vector<int>& order);
+    // the same without an index: entries[i] is where records[i] ended up
+    void storeChunk(int chunkId, const Record* records, size_t count, IndexEntry* entries);
+    void storeChunkDirect(int chunkId, const Record* records, size_t count, IndexEntry* entries);
+    void storeChunkCompressed(int chunkId, const Record* records, size_t count, IndexEntry* entries);
+    // compresses raw into path as chunk file chunkId
+    void storeCompressed(const std::string& path, const char* raw, size_t bytes);
+    // whole chunk file into buf, returns its size
+    size_t loadChunk(int chunkId, AlignedBuffer& buf);
+    // uncompressed contents of a compressed chunk, at least need bytes of
+    // it, from the cache if possible
+    ChunkData decompressedChunk(int chunkId, size_t need);
+    void clearCache();
+    // drops a rewritten or deleted chunk from every cache
+    void forgetChunk(int chunkId);
+    // where update() put data, in the tail chunk
+    IndexEntry appendToTail(const std::vector<char>& data);
+    // compresses the raw tail in place once it's full
+    void sealTail();
+    // index/recordOrder up to size entries, new ids removed until set
+    void growIndex(size_t size);
+    // logs and applies new entries in one go; whatever they replace is dead
+    void commit(const std::vector<IndexLog::Redirect>& batch);
+    // writes the index with the log folded in, when the log is long enough
+    void foldLog();
+    void writeIndex(const std::vector<IndexEntry>& entries, const std::vector<int>& order,
+                    uint64_t gen, const std::vector<size_t>& bytes);
+    // the index and order just written become the writer's and readers' state
+    void install(const std::vector<IndexEntry>& entries, const std::vector<int>& order);
     void readIndex();
+    // readIndex() unless the index is already in memory
+    void loadIndex();
+    // the writer's state as the new snapshot
+    void publish();
+    // loads the index if needed and returns the current snapshot, readable
+    // for as long as the Reader lives
+    SnapshotCell<Snapshot>::Reader snapshot();
 };
@@ -0,0 +1,268 @@
+#include "Codec.h"
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#ifdef DUNE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef DUNE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+class NoCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::None; }
+    std::string name() const override { return "none"; }
+    size_t maxCompressedSize(size_t n) const override { return n; }
+    
+    size_t compress(const char* src, size_t n, char* dst) const override {
+        std::memcpy(dst, src, n);
+        return n;
+    }
+    
+    void decompress(const char* src, size_t n, char* dst, size_t rawSize) const override {
+        if (n != rawSize) throw std::runtime_error("stored block has wrong size");
+        std::memcpy(dst, src, n);
+    }
+};
+
+// Same sequence layout as an LZ4 block: a token byte (literal length in the
+// high nibble, match length - 4 in the low nibble, 15 meaning "more length
+// bytes follow"), the literals, then a 2 byte little-endian match offset.
+// The last sequence is literals only. Greedy matching with a single-entry
+// hash table, which is good enough to squeeze the runs out of detector data.
+class LzCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::Lz; }
+    std::string name() const override { return "lz"; }
+    
+    size_t maxCompressedSize(size_t n) const override {
+        return n + n / 255 + 16;
+    }
+    
+    size_t compress(const char* src, size_t n, char* dst) const override {
+        const auto* in = reinterpret_cast<const uint8_t*>(src);
+        auto* out = reinterpret_cast<uint8_t*>(dst);
+        uint8_t* op = out;
+        
+        std::vector<uint32_t> table(hashSize, 0);
+        size_t anchor = 0;   // start of pending literals
+        size_t pos = 0;
+        
+        // leave room at the end so match finding never reads past n
+        size_t limit = n > lastLiterals ? n - lastLiterals : 0;
+        while (pos + minMatch <= limit) {
+            uint32_t seq = read32(in + pos);
+            uint32_t h = hash(seq);
+            size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(pos);
+            
+            if (candidate >= pos || pos - candidate > maxOffset || read32(in + candidate) != seq) {
+                ++pos;
+                continue;
+            }
+            
+            size_t len = minMatch;
+            while (pos + len < limit && in[candidate + len] == in[pos + len]) ++len;
+            
+            op = emitSequence(op, in + anchor, pos - anchor, len - minMatch);
+            uint16_t offset = static_cast<uint16_t>(pos - candidate);
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (len - minMatch >= 15) op = writeLength(op, len - minMatch - 15);
+            
+            pos += len;
+            anchor = pos;
+        }
+        
+        // trailing literals, no match part
+        op = emitSequence(op, in + anchor, n - anchor, 0);
+        return static_cast<size_t>(op - out);
+    }
+    
+    void decompress(const char* src, size_t n, char* dst, size_t rawSize) const override {
+        const auto* ip = reinterpret_cast<const uint8_t*>(src);
+        const auto* end = ip + n;
+        auto* out = reinterpret_cast<uint8_t*>(dst);
+        size_t op = 0;
+        
+        while (ip < end) {
+            uint8_t token = *ip++;
+            
+            size_t literals = token >> 4;
+            if (literals == 15) literals += readLength(ip, end);
+            if (literals > static_cast<size_t>(end - ip) || literals > rawSize - op)
+                throw std::runtime_error("corrupt lz block (literals)");
+            std::memcpy(out + op, ip, literals);
+            ip += literals;
+            op += literals;
+            
+            if (ip == end) break;  // last sequence
+            
+            if (end - ip < 2) throw std::runtime_error("corrupt lz block (offset)");
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t len = token & 0x0F;
+            if (len == 15) len += readLength(ip, end);
+            len += minMatch;
+            
+            if (offset == 0 || offset > op || len > rawSize - op)
+                throw std::runtime_error("corrupt lz block (match)");
+            // matches can overlap their own output (runs), so byte by byte
+            // unless they're far enough back
+            if (offset >= len) {
+                std::memcpy(out + op, out + op - offset, len);
+            } else {
+                for (size_t i = 0; i < len; ++i) out[op + i] = out[op - offset + i];
+            }
+            op += len;
+        }
+        
+        if (op != rawSize) throw std::runtime_error("corrupt lz block (size)");
+    }
+    
+private:
+    static constexpr size_t minMatch = 4;
+    static constexpr size_t lastLiterals = 5;
+    static constexpr size_t maxOffset = 65535;
+    static constexpr int hashBits = 14;
+    static constexpr size_t hashSize = size_t(1) << hashBits;
+    
+    static uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+    
+    static uint32_t hash(uint32_t v) {
+        return (v * 2654435761u) >> (32 - hashBits);
+    }
+    
+    static uint8_t* writeLength(uint8_t* op, size_t len) {
+        while (len >= 255) {
+            *op++ = 255;
+            len -= 255;
+        }
+        *op++ = static_cast<uint8_t>(len);
+        return op;
+    }
+    
+    static size_t readLength(const uint8_t*& ip, const uint8_t* end) {
+        size_t len = 0;
+        uint8_t b;
+        do {
+            if (ip == end) throw std::runtime_error("corrupt lz block (length)");
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return len;
+    }
+    
+    // token + literals. The caller appends the offset and then, if the
+    // match didn't fit in the token, its remaining length bytes.
+    static uint8_t* emitSequence(uint8_t* op, const uint8_t* literals, size_t numLiterals,
+                                 size_t matchExtra) {
+        *op++ = static_cast<uint8_t>((std::min<size_t>(numLiterals, 15) << 4) |
+                                     std::min<size_t>(matchExtra, 15));
+        if (numLiterals >= 15) op = writeLength(op, numLiterals - 15);
+        std::memcpy(op, literals, numLiterals);
+        return op + numLiterals;
+    }
+};
+
+#ifdef DUNE_HAVE_ZSTD
+class ZstdCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::Zstd; }
+    std::string name() const override { return "zstd"; }
+    size_t maxCompressedSize(size_t n) const override { return ZSTD_compressBound(n); }
+    
+    size_t compress(const char* src, size_t n, char* dst) const override {
+        size_t r = ZSTD_compress(dst, ZSTD_compressBound(n), src, n, level);
+        if (ZSTD_isError(r)) throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(r));
+        return r;
+    }
+    
+    void decompress(const char* src, size_t n, char* dst, size_t rawSize) const override {
+        size_t r = ZSTD_decompress(dst, rawSize, src, n);
+        if (ZSTD_isError(r) || r != rawSize) throw std::runtime_error("corrupt zstd block");
+    }
+    
+private:
+    static constexpr int level = 9;
+};
+#endif
+
+#ifdef DUNE_HAVE_ZLIB
+class ZlibCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::Zlib; }
+    std::string name() const override { return "zlib"; }
+    size_t maxCompressedSize(size_t n) const override { return compressBound(static_cast<uLong>(n)); }
+    
+    size_t compress(const char* src, size_t n, char* dst) const override {
+        uLongf outLen = compressBound(static_cast<uLong>(n));
+        int rc = compress2(reinterpret_cast<Bytef*>(dst), &outLen,
+                           reinterpret_cast<const Bytef*>(src), static_cast<uLong>(n), level);
+        if (rc != Z_OK) throw std::runtime_error("zlib compress failed");
+        return outLen;
+    }
+    
+    void decompress(const char* src, size_t n, char* dst, size_t rawSize) const override {
+        uLongf outLen = static_cast<uLongf>(rawSize);
+        int rc = uncompress(reinterpret_cast<Bytef*>(dst), &outLen,
+                            reinterpret_cast<const Bytef*>(src), static_cast<uLong>(n));
+        if (rc != Z_OK || outLen != rawSize) throw std::runtime_error("corrupt zlib block");
+    }
+    
+private:
+    static constexpr int level = 6;
+};
+#endif
+}
+
+bool Codec::available(CodecId id) {
+    switch (id) {
+    case CodecId::None:
+    case CodecId::Lz:
+        return true;
+    case CodecId::Zstd:
+#ifdef DUNE_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case CodecId::Zlib:
+#ifdef DUNE_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::unique_ptr<Codec> Codec::create(CodecId id) {
+    switch (id) {
+    case CodecId::None: return std::make_unique<NoCodec>();
+    case CodecId::Lz:   return std::make_unique<LzCodec>();
+#ifdef DUNE_HAVE_ZSTD
+    case CodecId::Zstd: return std::make_unique<ZstdCodec>();
+#endif
+#ifdef DUNE_HAVE_ZLIB
+    case CodecId::Zlib: return std::make_unique<ZlibCodec>();
+#endif
+    default:
+        throw std::invalid_argument("codec " + std::to_string(static_cast<int>(id)) +
+                                    " not available in this build");
+    }
+}
+
+CodecId Codec::bestRatio() {
+    if (available(CodecId::Zstd)) return CodecId::Zstd;
+    if (available(CodecId::Zlib)) return CodecId::Zlib;
+    return CodecId::Lz;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// on-disk codec ids, don't renumber
+enum class CodecId : uint8_t {
+    None = 0,
+    Lz   = 1,   // in-tree LZ4-style byte-aligned LZ77, fast, modest ratio
+    Zstd = 2,   // only if built against libzstd
+    Zlib = 3    // only if built against zlib
+};
+
+// Block compressor. Implementations are stateless, so one instance can be
+// shared by any number of threads.
+class Codec {
+public:
+    virtual ~Codec() = default;
+    
+    virtual CodecId id() const = 0;
+    virtual std::string name() const = 0;
+    
+    // worst case output size for n input bytes
+    virtual size_t maxCompressedSize(size_t n) const = 0;
+    // returns the compressed size, dst must hold maxCompressedSize(n)
+    virtual size_t compress(const char* src, size_t n, char* dst) const = 0;
+    // rawSize is known from the chunk header, throws on corrupt input
+    virtual void decompress(const char* src, size_t n, char* dst, size_t rawSize) const = 0;
+    
+    static bool available(CodecId id);
+    // throws if the codec wasn't compiled in
+    static std::unique_ptr<Codec> create(CodecId id);
+    // the best high-ratio codec this build has (zstd, else zlib, else lz)
+    static CodecId bestRatio();
+};
@@ -1,31 +1,84 @@
 #include "DataGenerator.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
 
-DataGenerator::DataGenerator(unsigned int seed)
-    : rng(seed), sizeDist(1024, 2048), byteDist(0, 255) {}
+DataGenerator::DataGenerator(unsigned int seed, double compressibility,
+                             size_t minSize, size_t maxSize, SizeDistribution sizes)
+    : rng(seed), sizeDist(minSize, maxSize), byteDist(0, 255),
+      // median a quarter of the way up the range, a few percent hit the max
+      tailDist(std::log(minSize + (maxSize - minSize) / 4.0 + 1.0), 0.5),
+      sizes(sizes), compressibility(compressibility) {
+    if (compressibility < 0.0 || compressibility > 1.0)
+        throw std::invalid_argument("compressibility must be between 0 and 1");
+    if (minSize == 0 || minSize > maxSize)
+        throw std::invalid_argument("record sizes need 0 < minSize <= maxSize");
+}
+
+size_t DataGenerator::nextSize() {
+    if (sizes == SizeDistribution::Uniform) return sizeDist(rng);
+    double size = tailDist(rng);
+    return std::clamp(static_cast<size_t>(size), sizeDist.min(), sizeDist.max());
+}
 
 std::vector<Record> DataGenerator::generateRecords(size_t count) {
     std::vector<Record> records;
     records.reserve(count);
     
     for (size_t i = 0; i < count; ++i) {
-        size_t size = sizeDist(rng);
+        size_t size = nextSize();
         records.emplace_back(static_cast<int>(i), size);
-        
-        for (size_t j = 0; j < size; ++j) {
-            records.back().data[j] = static_cast<char>(byteDist(rng));
-        }
+        fillPayload(records.back().data.data(), size);
     }
     
     return records;
 }
 
-Record DataGenerator::generateRecord(int id) {
-    size_t size = sizeDist(rng);
-    Record record(id, size);
+RecordBatch DataGenerator::generateBatch(size_t count) {
+    RecordBatch batch;
+    // a guess, the arena adds slabs if it comes up short
+    batch.reserve(count, count * ((sizeDist.min() + sizeDist.max()) / 2));
     
-    for (size_t i = 0; i < size; ++i) {
-        record.data[i] = static_cast<char>(byteDist(rng));
+    for (size_t i = 0; i < count; ++i) {
+        size_t size = nextSize();
+        fillPayload(batch.append(static_cast<int>(i), size), size);
     }
     
+    return batch;
+}
+
+Record DataGenerator::generateRecord(int id) {
+    size_t size = nextSize();
+    Record record(id, size);
+    fillPayload(record.data.data(), size);
     return record;
 }
+
+void DataGenerator::fillPayload(char* data, size_t size) {
+    if (compressibility <= 0.0) {
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(byteDist(rng));
+        }
+        return;
+    }
+    
+    // alternate quiet runs and noisy bursts, with run lengths picked so the
+    // quiet share comes out at about `compressibility`
+    constexpr double meanRun = 32.0;
+    std::geometric_distribution<size_t> quietLen(1.0 / (1.0 + meanRun * compressibility));
+    std::geometric_distribution<size_t> noisyLen(1.0 / (1.0 + meanRun * (1.0 - compressibility)));
+    const char pedestal = 0;
+    
+    size_t i = 0;
+    while (i < size) {
+        size_t quiet = std::min(quietLen(rng), size - i);
+        std::fill_n(data + i, quiet, pedestal);
+        i += quiet;
+        
+        size_t noisy = std::min(noisyLen(rng), size - i);
+        for (size_t j = 0; j < noisy; ++j) {
+            data[i + j] = static_cast<char>(byteDist(rng));
+        }
+        i += noisy;
+    }
+}
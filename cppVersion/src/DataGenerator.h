@@ -1,18 +1,39 @@
 #pragma once
 #include "Record.h"
+#include "RecordBatch.h"
 #include <vector>
 #include <random>
 
+enum class SizeDistribution {
+    Uniform,    // flat between minSize and maxSize
+    LogNormal   // most records small, long tail of big ones, clamped to the same range
+};
+
 // fixed seed for reproducibility.
+//
+// compressibility (0-1) is roughly the fraction of each record that is
+// quiet baseline instead of noise - runs of a constant pedestal value, like
+// zero-suppressed detector readout. 0 gives uniformly random bytes (and the
+// exact same data as before the knob existed), which no codec can shrink.
 class DataGenerator {
 public:
-    DataGenerator(unsigned int seed = 24);
+    DataGenerator(unsigned int seed = 24, double compressibility = 0.0,
+                  size_t minSize = 1024, size_t maxSize = 2048,
+                  SizeDistribution sizes = SizeDistribution::Uniform);
     
     std::vector<Record> generateRecords(size_t count);
+    // same records (same seed, same bytes) packed into one arena
+    RecordBatch generateBatch(size_t count);
     Record generateRecord(int id);
     
 private:
     std::mt19937 rng;
-    std::uniform_int_distribution<size_t> sizeDist; // 1024-2048 bytes
+    std::uniform_int_distribution<size_t> sizeDist; // 1024-2048 bytes by default
     std::uniform_int_distribution<int>    byteDist; // 0-255
+    std::lognormal_distribution<double>   tailDist;
+    SizeDistribution sizes;
+    double compressibility;
+    
+    size_t nextSize();
+    void fillPayload(char* data, size_t size);
 };
@@ -1,5 +1,7 @@
 #include "DataValidator.h"
+#include "Checksum.h"
 #include <iostream>
+#include <algorithm>
 
 uint32_t DataValidator::computeChecksum(const Record& record) {
     uint32_t checksum = 0;
@@ -60,3 +62,114 @@ bool DataValidator::verifySubset(const std::vector<Record>& original,
     
     return true;
 }
+
+bool DataValidator::verifyRecords(const std::vector<Record>& original,
+                                  const RecordBatch& read) {
+    if (original.size() != read.size()) {
+        std::cerr << "record count mismatch: wrote " << original.size()
+                  << " read back " << read.size() << std::endl;
+        return false;
+    }
+    
+    for (size_t i = 0; i < original.size(); ++i) {
+        if (original[i].id != read[i].id) {
+            std::cerr << "ID mismatch at position " << i
+                      << " (expected " << original[i].id
+                      << ", got " << read[i].id << ")" << std::endl;
+            return false;
+        }
+        if (!verifyView(original, read[i])) return false;
+    }
+    
+    return true;
+}
+
+bool DataValidator::verifySubset(const std::vector<Record>& original,
+                                 const RecordBatch& read,
+                                 const std::vector<int>& indices) {
+    if (indices.size() != read.size()) {
+        std::cerr << "subset size mismatch" << std::endl;
+        return false;
+    }
+    
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (read[i].id != indices[i]) {
+            std::cerr << "ID mismatch at position " << i << std::endl;
+            return false;
+        }
+        if (!verifyView(original, read[i])) return false;
+    }
+    
+    return true;
+}
+
+bool DataValidator::verifyView(const std::vector<Record>& original,
+                               const RecordView& view) {
+    if (view.id < 0 || static_cast<size_t>(view.id) >= original.size()) {
+        std::cerr << "unexpected record id " << view.id << std::endl;
+        return false;
+    }
+    
+    const auto& orig = original[view.id];
+    if (orig.data.size() != view.size ||
+        !std::equal(orig.data.begin(), orig.data.end(), view.data)) {
+        std::cerr << "data mismatch for record " << view.id << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
+bool DataValidator::verifyChecksum(const std::vector<uint32_t>& expected,
+                                   const RecordView& view) {
+    if (view.id < 0 || static_cast<size_t>(view.id) >= expected.size()) {
+        std::cerr << "unexpected record id " << view.id << std::endl;
+        return false;
+    }
+    
+    if (crc32c(view.data, view.size) != expected[view.id]) {
+        std::cerr << "checksum mismatch for record " << view.id << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
+bool DataValidator::verifyChecksums(const std::vector<uint32_t>& expected,
+                                    const std::vector<Record>& read,
+                                    const std::vector<int>& indices) {
+    if (indices.size() != read.size()) {
+        std::cerr << "subset size mismatch" << std::endl;
+        return false;
+    }
+    
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (read[i].id != indices[i]) {
+            std::cerr << "ID mismatch at position " << i << std::endl;
+            return false;
+        }
+        RecordView view(read[i].id, read[i].data.data(), read[i].data.size());
+        if (!verifyChecksum(expected, view)) return false;
+    }
+    
+    return true;
+}
+
+bool DataValidator::verifyChecksums(const std::vector<uint32_t>& expected,
+                                    const RecordBatch& read,
+                                    const std::vector<int>& indices) {
+    if (indices.size() != read.size()) {
+        std::cerr << "subset size mismatch" << std::endl;
+        return false;
+    }
+    
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (read[i].id != indices[i]) {
+            std::cerr << "ID mismatch at position " << i << std::endl;
+            return false;
+        }
+        if (!verifyChecksum(expected, read[i])) return false;
+    }
+    
+    return true;
+}
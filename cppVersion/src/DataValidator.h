@@ -1,5 +1,6 @@
 #pragma once
 #include "Record.h"
+#include "RecordBatch.h"
 #include <vector>
 #include <cstdint>
 
@@ -13,4 +14,26 @@ public:
     static bool verifySubset(const std::vector<Record>& original,
                             const std::vector<Record>& read,
                             const std::vector<int>& indices);
+    
+    // arena-backed reads, same checks as above
+    static bool verifyRecords(const std::vector<Record>& original,
+                              const RecordBatch& read);
+    static bool verifySubset(const std::vector<Record>& original,
+                             const RecordBatch& read,
+                             const std::vector<int>& indices);
+    
+    // for the scan API - views carry their id, originals are indexed by id
+    static bool verifyView(const std::vector<Record>& original,
+                           const RecordView& view);
+    
+    // streaming runs only keep a crc32c per record, indexed by id
+    static bool verifyChecksum(const std::vector<uint32_t>& expected,
+                               const RecordView& view);
+    
+    static bool verifyChecksums(const std::vector<uint32_t>& expected,
+                                const std::vector<Record>& read,
+                                const std::vector<int>& indices);
+    static bool verifyChecksums(const std::vector<uint32_t>& expected,
+                                const RecordBatch& read,
+                                const std::vector<int>& indices);
 };
@@ -0,0 +1,110 @@
+#include "DirectFile.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+DirectFile::DirectFile(const std::string& path, Mode mode) : path(path) {
+#ifdef _WIN32
+    // FILE_FLAG_NO_BUFFERING would need the whole thing on HANDLEs, so
+    // Windows just gets ordinary buffered I/O here
+    int flags = _O_BINARY | (mode == Mode::Write ? (_O_WRONLY | _O_CREAT | _O_TRUNC) : _O_RDONLY);
+    fd = _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    int flags = mode == Mode::Write ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+#ifdef O_DIRECT
+    fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    if (fd >= 0) direct = true;
+    else if (errno == EINVAL) fd = ::open(path.c_str(), flags, 0644);
+#else
+    fd = ::open(path.c_str(), flags, 0644);
+#ifdef F_NOCACHE
+    if (fd >= 0) direct = fcntl(fd, F_NOCACHE, 1) == 0;
+#endif
+#endif
+#endif
+    if (fd < 0)
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+}
+
+DirectFile::~DirectFile() {
+#ifdef _WIN32
+    if (fd >= 0) _close(fd);
+#else
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+void DirectFile::writeAt(const char* data, size_t len, size_t offset) {
+    size_t done = 0;
+    while (done < len) {
+#ifdef _WIN32
+        _lseeki64(fd, static_cast<__int64>(offset + done), SEEK_SET);
+        int n = _write(fd, data + done, static_cast<unsigned>(len - done));
+#else
+        ssize_t n = pwrite(fd, data + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) throw std::runtime_error("write failed: " + path + ": " + std::strerror(errno));
+        done += static_cast<size_t>(n);
+    }
+}
+
+size_t DirectFile::readAt(char* dest, size_t len, size_t offset) {
+    size_t done = 0;
+    while (done < len) {
+#ifdef _WIN32
+        _lseeki64(fd, static_cast<__int64>(offset + done), SEEK_SET);
+        int n = _read(fd, dest + done, static_cast<unsigned>(len - done));
+#else
+        ssize_t n = pread(fd, dest + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n < 0) throw std::runtime_error("read failed: " + path + ": " + std::strerror(errno));
+        if (n == 0) break;  // end of file
+        done += static_cast<size_t>(n);
+        // O_DIRECT reads stop short at EOF; the next read would be unaligned
+        if (done % AlignedBuffer::alignment != 0) break;
+    }
+    return done;
+}
+
+const char* DirectFile::readRange(AlignedBuffer& buf, size_t offset, size_t len) {
+    size_t start = alignDown(offset);
+    size_t end = alignUp(offset + len);
+    buf.reserve(end - start);
+    
+    size_t got = readAt(buf.data(), end - start, start);
+    if (got < offset + len - start)
+        throw std::runtime_error("short read from " + path);
+    return buf.data() + (offset - start);
+}
+
+void DirectFile::truncate(size_t size) {
+#ifdef _WIN32
+    int rc = _chsize_s(fd, static_cast<__int64>(size));
+#else
+    int rc = ftruncate(fd, static_cast<off_t>(size));
+#endif
+    if (rc != 0) throw std::runtime_error("truncate failed: " + path);
+}
+
+size_t DirectFile::size() const {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_fstat64(fd, &st) != 0) throw std::runtime_error("stat failed: " + path);
+#else
+    struct stat st;
+    if (fstat(fd, &st) != 0) throw std::runtime_error("stat failed: " + path);
+#endif
+    return static_cast<size_t>(st.st_size);
+}
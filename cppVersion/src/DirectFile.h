@@ -0,0 +1,40 @@
+#pragma once
+#include "AlignedBuffer.h"
+#include <string>
+#include <cstddef>
+
+// File opened for unbuffered I/O (O_DIRECT on Linux, F_NOCACHE on macOS),
+// so reads and writes go to the device instead of the page cache. Buffers,
+// offsets and lengths passed to writeAt/readAt must all be multiples of
+// AlignedBuffer::alignment.
+//
+// If the filesystem refuses O_DIRECT (tmpfs, some network mounts) the file
+// is opened normally instead and isDirect() says so.
+class DirectFile {
+public:
+    enum class Mode { Read, Write };
+    
+    DirectFile(const std::string& path, Mode mode);
+    ~DirectFile();
+    
+    DirectFile(const DirectFile&) = delete;
+    DirectFile& operator=(const DirectFile&) = delete;
+    
+    void writeAt(const char* data, size_t len, size_t offset);
+    // may return less than len at end of file
+    size_t readAt(char* dest, size_t len, size_t offset);
+    
+    // reads the (unaligned) byte range [offset, offset + len) by reading the
+    // aligned pages around it into buf. Returns a pointer to offset in buf.
+    const char* readRange(AlignedBuffer& buf, size_t offset, size_t len);
+    
+    // drops the padding from the last aligned write
+    void truncate(size_t size);
+    size_t size() const;
+    bool isDirect() const { return direct; }
+    
+private:
+    std::string path;
+    int fd = -1;
+    bool direct = false;
+};
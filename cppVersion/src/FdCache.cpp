@@ -0,0 +1,116 @@
+#include "FdCache.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+FdCache::File::File(const std::string& path) : filePath(path) {
+#ifdef _WIN32
+    handle = _open(path.c_str(), _O_BINARY | _O_RDONLY);
+#else
+    handle = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (handle < 0) throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+}
+
+FdCache::File::~File() {
+#ifdef _WIN32
+    _close(handle);
+#else
+    ::close(handle);
+#endif
+}
+
+size_t FdCache::File::size() const {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_fstat64(handle, &st) != 0)
+#else
+    struct stat st;
+    if (fstat(handle, &st) != 0)
+#endif
+        throw std::runtime_error("fstat failed: " + filePath);
+    return static_cast<size_t>(st.st_size);
+}
+
+size_t FdCache::File::readSome(char* dest, size_t len, size_t offset) const {
+    size_t done = 0;
+    while (done < len) {
+#ifdef _WIN32
+        // no pread, and the file position is shared - good enough for the
+        // single threaded Windows runs
+        _lseeki64(handle, static_cast<__int64>(offset + done), SEEK_SET);
+        int n = _read(handle, dest + done, static_cast<unsigned>(len - done));
+#else
+        ssize_t n = pread(handle, dest + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n < 0) throw std::runtime_error("read failed: " + filePath + ": " + std::strerror(errno));
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+void FdCache::File::readAt(char* dest, size_t len, size_t offset) const {
+    if (readSome(dest, len, offset) != len) throw std::runtime_error("short read from " + filePath);
+}
+
+FdCache::FdCache(size_t capacity) : maxOpen(capacity ? capacity : 1) {}
+
+FdCache::Handle FdCache::acquire(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = byPath.find(path);
+        if (it != byPath.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            counters.reuses++;
+            return it->second->file;
+        }
+    }
+    
+    // open outside the lock, that's the slow part on a network filesystem.
+    // Two threads can race to open the same file; the loser's fd just
+    // isn't cached.
+    auto file = std::make_shared<const File>(path);
+    
+    std::lock_guard<std::mutex> lock(mtx);
+    counters.opens++;
+    if (byPath.count(path)) return file;
+    lru.push_front({path, file});
+    byPath[path] = lru.begin();
+    if (lru.size() > maxOpen) {
+        byPath.erase(lru.back().path);
+        lru.pop_back();
+        counters.evictions++;
+    }
+    return file;
+}
+
+void FdCache::forget(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = byPath.find(path);
+    if (it == byPath.end()) return;
+    lru.erase(it->second);
+    byPath.erase(it);
+}
+
+void FdCache::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    lru.clear();
+    byPath.clear();
+}
+
+FdCache::Stats FdCache::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return counters;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstddef>
+
+// Bounded LRU of open read-only file descriptors, so readers that hop
+// between many files (Chunked random reads) don't pay open()/close() every
+// time. Handles are shared: an fd evicted while a reader still holds it is
+// closed when that reader lets go. Thread safe; reads go through pread so
+// several threads can use one fd at once.
+class FdCache {
+public:
+    // one open descriptor, closed on destruction
+    class File {
+    public:
+        File(const std::string& path);
+        ~File();
+        
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+        
+        int fd() const { return handle; }
+        size_t size() const;
+        // exactly len bytes at offset, throws std::runtime_error on a short read
+        void readAt(char* dest, size_t len, size_t offset) const;
+        // up to len bytes, less only at end of file
+        size_t readSome(char* dest, size_t len, size_t offset) const;
+        const std::string& path() const { return filePath; }
+        
+    private:
+        std::string filePath;
+        int handle = -1;
+    };
+    
+    using Handle = std::shared_ptr<const File>;
+    
+    struct Stats {
+        size_t opens = 0;      // open() calls made
+        size_t reuses = 0;     // acquires served from an fd already open
+        size_t evictions = 0;
+    };
+    
+    explicit FdCache(size_t capacity = 256);
+    
+    FdCache(const FdCache&) = delete;
+    FdCache& operator=(const FdCache&) = delete;
+    
+    // throws std::runtime_error if the file can't be opened
+    Handle acquire(const std::string& path);
+    
+    // call after deleting or replacing a file
+    void forget(const std::string& path);
+    void clear();
+    
+    size_t capacity() const { return maxOpen; }
+    Stats stats() const;
+    
+private:
+    struct Entry {
+        std::string path;
+        Handle file;
+    };
+    
+    size_t maxOpen;
+    mutable std::mutex mtx;
+    std::list<Entry> lru;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> byPath;
+    Stats counters;
+};
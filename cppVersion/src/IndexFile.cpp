@@ -0,0 +1,358 @@
+#include "IndexFile.h"
+#include "Checksum.h"
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool bigEndian = true;
+#else
+constexpr bool bigEndian = false;
+#endif
+
+template <typename T>
+T swapBytes(T value) {
+    T out;
+    const char* src = reinterpret_cast<const char*>(&value);
+    char* dst = reinterpret_cast<char*>(&out);
+    for (size_t i = 0; i < sizeof(T); ++i) dst[i] = src[sizeof(T) - 1 - i];
+    return out;
+}
+
+template <typename T>
+T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    if constexpr (bigEndian) value = swapBytes(value);
+    return value;
+}
+
+template <typename T>
+void store(char* p, T value) {
+    if constexpr (bigEndian) value = swapBytes(value);
+    std::memcpy(p, &value, sizeof(T));
+}
+
+size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// where each column starts, relative to the start of the file
+struct Layout {
+    size_t keys, crcs, sizes, deltas, anchors, order, aux, end;
+    
+    Layout(size_t count, uint16_t flags, size_t blockEntries, size_t numAux) {
+        size_t at = IndexFile::headerSize;
+        keys = at;    at = align8(at + count * 4);
+        crcs = at;    if (flags & IndexFile::FlagChecksums) at = align8(at + count * 4);
+        sizes = at;   at = align8(at + count * ((flags & IndexFile::FlagWideSizes) ? 4 : 2));
+        deltas = at;  at = align8(at + count * ((flags & IndexFile::FlagWideOffsets) ? 8 : 4));
+        anchors = at; at += (count + blockEntries - 1) / blockEntries * 8;
+        order = at;   if (flags & IndexFile::FlagOrder) at = align8(at + count * 4);
+        aux = at;     at += numAux * 8;
+        end = at;
+    }
+};
+
+// buffers one column at a time and keeps a running crc of everything written
+class BodyWriter {
+public:
+    explicit BodyWriter(std::ofstream& out) : out(out) { buf.reserve(bufferSize); }
+    
+    template <typename T>
+    void put(T value) {
+        if (buf.size() + sizeof(T) > bufferSize) flush();
+        size_t at = buf.size();
+        buf.resize(at + sizeof(T));
+        store(buf.data() + at, value);
+    }
+    
+    // zero fill up to the next 8 byte boundary
+    void pad() {
+        while ((written + buf.size()) % 8) put<uint8_t>(0);
+    }
+    
+    void flush() {
+        crc = crc32c(buf.data(), buf.size(), crc);
+        out.write(buf.data(), buf.size());
+        written += buf.size();
+        buf.clear();
+    }
+    
+    uint32_t checksum() const { return crc; }
+    size_t bytes() const { return written; }
+    
+private:
+    static constexpr size_t bufferSize = 1024 * 1024;
+    std::ofstream& out;
+    std::vector<char> buf;
+    uint32_t crc = 0;
+    size_t written = IndexFile::headerSize;  // so pad() lines up with file offsets
+};
+}
+
+void IndexFile::write(const std::string& path, const Contents& contents) {
+    static const std::vector<IndexEntry> none;
+    const auto& entries = contents.entries ? *contents.entries : none;
+    size_t count = entries.size();
+    if (contents.order && contents.order->size() != count)
+        throw std::invalid_argument("index order has " + std::to_string(contents.order->size()) +
+                                    " entries, expected " + std::to_string(count));
+    
+    uint16_t flags = 0;
+    if (contents.checksums) flags |= FlagChecksums;
+    if (contents.order) flags |= FlagOrder;
+    
+    std::vector<uint64_t> anchorOf((count + blockEntries - 1) / blockEntries);
+    for (size_t b = 0; b < anchorOf.size(); ++b) {
+        size_t first = b * blockEntries;
+        size_t last = std::min(count, first + blockEntries);
+        uint64_t lowest = std::numeric_limits<uint64_t>::max();
+        uint64_t highest = 0;
+        for (size_t i = first; i < last; ++i) {
+            const auto& entry = entries[i];
+            if (entry.recordId < removed)
+                throw std::invalid_argument("negative id in index: " + std::to_string(entry.recordId));
+            if (entry.size > std::numeric_limits<uint32_t>::max())
+                throw std::invalid_argument("record too large for index: " + std::to_string(entry.size));
+            if (entry.size > std::numeric_limits<uint16_t>::max()) flags |= FlagWideSizes;
+            lowest = std::min<uint64_t>(lowest, entry.offset);
+            highest = std::max<uint64_t>(highest, entry.offset);
+        }
+        anchorOf[b] = lowest;
+        if (highest - lowest > std::numeric_limits<uint32_t>::max()) flags |= FlagWideOffsets;
+    }
+    
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open index file for writing: " + tmpPath);
+    
+    // header goes in last, once the body crc is known
+    char header[headerSize] = {};
+    out.write(header, headerSize);
+    
+    BodyWriter body(out);
+    for (const auto& entry : entries) body.put<uint32_t>(static_cast<uint32_t>(entry.recordId));
+    body.pad();
+    if (flags & FlagChecksums) {
+        for (const auto& entry : entries) body.put<uint32_t>(entry.checksum);
+        body.pad();
+    }
+    for (const auto& entry : entries) {
+        if (flags & FlagWideSizes) body.put<uint32_t>(static_cast<uint32_t>(entry.size));
+        else                       body.put<uint16_t>(static_cast<uint16_t>(entry.size));
+    }
+    body.pad();
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t delta = entries[i].offset - anchorOf[i / blockEntries];
+        if (flags & FlagWideOffsets) body.put<uint64_t>(delta);
+        else                         body.put<uint32_t>(static_cast<uint32_t>(delta));
+    }
+    body.pad();
+    for (uint64_t anchor : anchorOf) body.put<uint64_t>(anchor);
+    if (contents.order) {
+        for (int pos : *contents.order) {
+            if (pos < 0) throw std::invalid_argument("negative position in index order");
+            body.put<uint32_t>(static_cast<uint32_t>(pos));
+        }
+        body.pad();
+    }
+    for (uint64_t value : contents.aux) body.put<uint64_t>(value);
+    body.flush();
+    
+    uint64_t bodyBytes = body.bytes() - headerSize;
+    store<uint32_t>(header + 0, magic);
+    store<uint16_t>(header + 4, version);
+    store<uint16_t>(header + 6, flags);
+    store<uint64_t>(header + 8, count);
+    store<uint32_t>(header + 16, blockEntries);
+    store<uint32_t>(header + 20, static_cast<uint32_t>(contents.aux.size()));
+    store<uint64_t>(header + 24, bodyBytes);
+    store<uint32_t>(header + 32, body.checksum());
+    store<uint32_t>(header + 60, crc32c(header, 60));
+    out.seekp(0);
+    out.write(header, headerSize);
+    
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write index file: " + tmpPath);
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) throw std::runtime_error("Failed to publish index file " + path + ": " + ec.message());
+}
+
+IndexFile::IndexFile(const std::string& path, bool verifyBody) {
+    open(path, verifyBody);
+}
+
+void IndexFile::open(const std::string& path, bool verifyBody) {
+    close();
+    file.open(path);
+    const char* data = file.data();
+    
+    if (file.size() < headerSize) throw std::runtime_error("index file too short: " + path);
+    if (load<uint32_t>(data) != magic) throw std::runtime_error("not an index file: " + path);
+    if (load<uint32_t>(data + 60) != crc32c(data, 60))
+        throw std::runtime_error("index header checksum mismatch: " + path);
+    uint16_t fileVersion = load<uint16_t>(data + 4);
+    if (fileVersion != version)
+        throw std::runtime_error("unsupported index version " + std::to_string(fileVersion) + ": " + path);
+    
+    uint16_t fileFlags = load<uint16_t>(data + 6);
+    uint64_t fileCount = load<uint64_t>(data + 8);
+    uint32_t fileBlock = load<uint32_t>(data + 16);
+    uint32_t fileAux = load<uint32_t>(data + 20);
+    uint64_t bodyBytes = load<uint64_t>(data + 24);
+    if (fileBlock != blockEntries) throw std::runtime_error("unexpected index block size: " + path);
+    
+    Layout layout(fileCount, fileFlags, fileBlock, fileAux);
+    if (layout.end != headerSize + bodyBytes || file.size() != layout.end)
+        throw std::runtime_error("index file truncated: " + path);
+    if (verifyBody && crc32c(data + headerSize, bodyBytes) != load<uint32_t>(data + 32))
+        throw std::runtime_error("index checksum mismatch: " + path);
+    
+    count = fileCount;
+    numAux = fileAux;
+    flagBits = fileFlags;
+    keys = data + layout.keys;
+    crcs = data + layout.crcs;
+    sizes = data + layout.sizes;
+    deltas = data + layout.deltas;
+    anchors = data + layout.anchors;
+    orders = data + layout.order;
+    auxes = data + layout.aux;
+}
+
+void IndexFile::close() {
+    file.close();
+    count = 0;
+    numAux = 0;
+    flagBits = 0;
+}
+
+IndexEntry IndexFile::entry(size_t i) const {
+    uint32_t key = load<uint32_t>(keys + i * 4);
+    uint32_t crc = (flagBits & FlagChecksums) ? load<uint32_t>(crcs + i * 4) : 0;
+    size_t size = (flagBits & FlagWideSizes) ? load<uint32_t>(sizes + i * 4) : load<uint16_t>(sizes + i * 2);
+    uint64_t delta = (flagBits & FlagWideOffsets) ? load<uint64_t>(deltas + i * 8) : load<uint32_t>(deltas + i * 4);
+    uint64_t anchor = load<uint64_t>(anchors + (i / blockEntries) * 8);
+    return IndexEntry(static_cast<int>(key), static_cast<size_t>(anchor + delta), size, crc);
+}
+
+int IndexFile::order(size_t i) const {
+    return static_cast<int>(load<uint32_t>(orders + i * 4));
+}
+
+uint64_t IndexFile::aux(size_t i) const {
+    return load<uint64_t>(auxes + i * 8);
+}
+
+void IndexFile::decode(std::vector<IndexEntry>& out) const {
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) out[i] = entry(i);
+}
+
+void IndexFile::decodeOrder(std::vector<int>& out) const {
+    out.clear();
+    if (!hasOrder()) return;
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) out[i] = order(i);
+}
+
+std::vector<IndexLog::Redirect> IndexLog::open(const std::string& path, uint64_t generation) {
+    close();
+    logPath = path;
+    std::vector<Redirect> redirects;
+    
+    // every whole batch up to the first frame that doesn't check out
+    size_t valid = 0;
+    {
+        std::ifstream in(path, std::ios::binary);
+        char header[headerSize];
+        if (in && in.read(header, headerSize) && load<uint32_t>(header) == magic &&
+            load<uint16_t>(header + 4) == version && load<uint64_t>(header + 8) == generation) {
+            valid = headerSize;
+            std::vector<Redirect> batch;
+            uint32_t expected = 0;  // frames still owed by the open batch
+            char frame[frameSize];
+            while (in.read(frame, frameSize)) {
+                if (load<uint32_t>(frame + 28) != crc32c(frame, 28)) break;
+                uint32_t more = load<uint32_t>(frame + 24);
+                if (!batch.empty() && more + 1 != expected) break;
+                Redirect r;
+                r.id = static_cast<int>(load<uint32_t>(frame + 4));
+                r.entry = IndexEntry(static_cast<int>(load<uint32_t>(frame)),
+                                     static_cast<size_t>(load<uint64_t>(frame + 8)),
+                                     load<uint32_t>(frame + 16), load<uint32_t>(frame + 20));
+                batch.push_back(r);
+                expected = more;
+                if (more == 0) {
+                    redirects.insert(redirects.end(), batch.begin(), batch.end());
+                    valid += batch.size() * frameSize;
+                    batch.clear();
+                }
+            }
+        }
+    }
+    
+    if (valid == 0) {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Failed to open index log for writing: " + path);
+        char header[headerSize] = {};
+        store<uint32_t>(header, magic);
+        store<uint16_t>(header + 4, version);
+        store<uint64_t>(header + 8, generation);
+        out.write(header, headerSize);
+        out.flush();
+    } else {
+        std::error_code ec;
+        if (std::filesystem::file_size(path, ec) != valid && !ec)
+            std::filesystem::resize_file(path, valid, ec);
+        if (ec) throw std::runtime_error("Failed to trim index log " + path + ": " + ec.message());
+        out.open(path, std::ios::binary | std::ios::app);
+        if (!out) throw std::runtime_error("Failed to open index log for writing: " + path);
+    }
+    if (!out) throw std::runtime_error("Failed to write index log: " + path);
+    frames = redirects.size();
+    return redirects;
+}
+
+void IndexLog::append(const Redirect& redirect) {
+    append(std::vector<Redirect>{redirect});
+}
+
+void IndexLog::append(const std::vector<Redirect>& batch) {
+    if (!out.is_open()) throw std::logic_error("index log not open");
+    if (batch.empty()) return;
+    if (batch.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("index log batch too large");
+    
+    std::vector<char> buf(batch.size() * frameSize);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const IndexEntry& entry = batch[i].entry;
+        if (batch[i].id < 0 || entry.recordId < IndexFile::removed)
+            throw std::invalid_argument("negative id in index log: " + std::to_string(batch[i].id));
+        if (entry.size > std::numeric_limits<uint32_t>::max())
+            throw std::invalid_argument("record too large for index: " + std::to_string(entry.size));
+        
+        char* frame = buf.data() + i * frameSize;
+        store<uint32_t>(frame, static_cast<uint32_t>(entry.recordId));
+        store<uint32_t>(frame + 4, static_cast<uint32_t>(batch[i].id));
+        store<uint64_t>(frame + 8, entry.offset);
+        store<uint32_t>(frame + 16, static_cast<uint32_t>(entry.size));
+        store<uint32_t>(frame + 20, entry.checksum);
+        store<uint32_t>(frame + 24, static_cast<uint32_t>(batch.size() - 1 - i));
+        store<uint32_t>(frame + 28, crc32c(frame, 28));
+    }
+    out.write(buf.data(), buf.size());
+    out.flush();
+    if (!out) throw std::runtime_error("Failed to write index log: " + logPath);
+    frames += batch.size();
+}
+
+void IndexLog::close() {
+    if (out.is_open()) out.close();
+    out.clear();
+    frames = 0;
+}
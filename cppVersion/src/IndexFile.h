@@ -0,0 +1,150 @@
+#pragma once
+#include "Record.h"
+#include "MappedFile.h"
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Versioned on-disk index shared by the SingleFile, Chunked, Sharded and
+// AppendLog strategies. Everything is little-endian and column-major, so a
+// mapped file can be queried in place with entry(i) and never loaded:
+//
+//   header     64 bytes, see below
+//   keys       uint32 per entry (record id, or chunk id for Chunked)
+//   checksums  uint32 per entry, only with FlagChecksums
+//   sizes      uint16 per entry, uint32 with FlagWideSizes
+//   deltas     uint32 per entry, uint64 with FlagWideOffsets
+//   anchors    uint64 per block of blockEntries entries
+//   order      uint32 per entry, only with FlagOrder (Chunked read order)
+//   aux        uint64 x auxCount, strategy specific (chunk count, shard starts)
+//
+// Offsets are frame-of-reference encoded: entry i lives at
+// anchors[i / blockEntries] + deltas[i], with the anchor being the lowest
+// offset in its block. Each column starts 8-byte aligned.
+//
+// Header: magic, version, flags, count, blockEntries, auxCount, bodyBytes,
+// crc32c of the body, then a crc32c of the header itself in the last 4
+// bytes.
+//
+// A key of 0xffffffff (recordId -1 in memory) is a removed record. The file
+// is written next to its final name and renamed over it, so a reader opens
+// either the old index or the new one, never half of one.
+class IndexFile {
+public:
+    static constexpr uint32_t magic = 0x58444944;  // "DIDX"
+    static constexpr uint16_t version = 1;
+    static constexpr size_t headerSize = 64;
+    static constexpr uint32_t blockEntries = 64;
+    
+    enum Flags : uint16_t {
+        FlagChecksums   = 1 << 0,
+        FlagWideSizes   = 1 << 1,
+        FlagWideOffsets = 1 << 2,
+        FlagOrder       = 1 << 3,
+    };
+    
+    // What gets written. order and aux are optional.
+    struct Contents {
+        const std::vector<IndexEntry>* entries = nullptr;
+        bool checksums = true;
+        const std::vector<int>* order = nullptr;
+        std::vector<uint64_t> aux;
+    };
+    
+    // Throws std::runtime_error if the file can't be written and
+    // std::invalid_argument for ids or sizes the format can't hold.
+    static void write(const std::string& path, const Contents& contents);
+    
+    // key of a removed record
+    static constexpr int removed = -1;
+    
+    IndexFile() = default;
+    explicit IndexFile(const std::string& path, bool verifyBody = true);
+    
+    // Maps the file and checks the header. With verifyBody the body crc is
+    // checked too, which touches every page - skip it for huge indexes that
+    // should stay lazily paged in. Throws std::runtime_error on anything
+    // malformed.
+    void open(const std::string& path, bool verifyBody = true);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    
+    size_t size() const { return count; }
+    uint16_t flags() const { return flagBits; }
+    bool hasChecksums() const { return flagBits & FlagChecksums; }
+    bool hasOrder() const { return flagBits & FlagOrder; }
+    
+    // in-place lookups, no bounds checks
+    IndexEntry entry(size_t i) const;
+    int order(size_t i) const;
+    size_t auxCount() const { return numAux; }
+    uint64_t aux(size_t i) const;
+    
+    // whole columns at once, for callers that want a std::vector anyway
+    void decode(std::vector<IndexEntry>& out) const;
+    void decodeOrder(std::vector<int>& out) const;
+    
+private:
+    MappedFile file;
+    size_t count = 0;
+    size_t numAux = 0;
+    uint16_t flagBits = 0;
+    const char* keys = nullptr;
+    const char* crcs = nullptr;
+    const char* sizes = nullptr;
+    const char* deltas = nullptr;
+    const char* anchors = nullptr;
+    const char* orders = nullptr;
+    const char* auxes = nullptr;
+};
+
+// Redirects appended to an index after it was written, so changing one
+// record doesn't mean rewriting the whole IndexFile. Little-endian like the
+// index:
+//
+//   header  [uint32 magic][uint16 version][uint16 0][uint64 generation]
+//   frames  [uint32 key][uint32 id][uint64 offset][uint32 size][uint32 checksum]
+//           [uint32 more][uint32 crc32c of the 28 bytes before it]
+//
+// Each frame replaces entry `id` (key -1 removes it, ids past the end grow
+// the index). Frames come in batches that apply all or nothing: `more`
+// counts the frames still to come in the frame's batch, so a batch ends at
+// the frame where it's 0. The generation ties a log to the index it applies to: the
+// owner bumps it whenever it rewrites the index with the redirects folded
+// in, and a log from any other generation is stale and gets dropped.
+class IndexLog {
+public:
+    static constexpr uint32_t magic = 0x474c4944;  // "DILG"
+    static constexpr uint16_t version = 1;
+    static constexpr size_t headerSize = 16;
+    static constexpr size_t frameSize = 32;
+    
+    struct Redirect {
+        int id;
+        IndexEntry entry;
+    };
+    
+    IndexLog() = default;
+    IndexLog(const IndexLog&) = delete;
+    IndexLog& operator=(const IndexLog&) = delete;
+    
+    // The redirects logged against `generation`, in order. The log stays
+    // open for append() behind them; a missing or stale log is started
+    // afresh and a torn last batch (a crash mid-append) cut off. Throws
+    // std::runtime_error if the file can't be read or written.
+    std::vector<Redirect> open(const std::string& path, uint64_t generation);
+    // one batch, written and flushed in one go
+    void append(const Redirect& redirect);
+    void append(const std::vector<Redirect>& batch);
+    void close();
+    
+    bool isOpen() const { return out.is_open(); }
+    size_t size() const { return frames; }
+    
+private:
+    std::string logPath;
+    std::ofstream out;
+    size_t frames = 0;
+};
@@ -3,11 +3,13 @@
 #include <filesystem>
 #include <stdexcept>
 #include <cstdio>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
-IndividualFileStrategy::IndividualFileStrategy(const std::string& dir)
-    : totalRecords(0) {
+IndividualFileStrategy::IndividualFileStrategy(const std::string& dir, IoEngine engine,
+                                               size_t queueDepth)
+    : totalRecords(0), async(AsyncFileIO::create(engine, queueDepth)) {
     baseDir = dir;
     fs::create_directories(dir);
 }
@@ -31,19 +33,75 @@ void IndividualFileStrategy::ensureSubdirectories(size_t numRecords) {
 }
 
 void IndividualFileStrategy::write(const std::vector<Record>& records) {
-    totalRecords = records.size();
-    recordSizes.resize(records.size());
-    
-    ensureSubdirectories(totalRecords);
+    if (!async) {
+        VectorRecordStream stream(records);
+        writeStream(stream);
+        return;
+    }
     
-    // this is slow but not much we can do - filesystem overhead dominates
-    // TODO: maybe try async writes?
+    startWrite(records.size());
+    std::vector<AsyncFileIO::WriteOp> ops;
+    ops.reserve(records.size());
     for (const auto& record : records) {
         recordSizes[record.id] = record.data.size();
+        ops.push_back({getRecordFileName(record.id), record.data.data(), record.data.size()});
+    }
+    async->writeFiles(ops);
+}
+
+void IndividualFileStrategy::writeStream(RecordStream& stream) {
+    startWrite(stream.size());
+    
+    if (async) {
+        // the engines want every buffer of a batch alive at once, so copy
+        // a batch worth out of the stream at a time
+        constexpr size_t batchSize = 4096;
+        std::vector<Record> batch(batchSize);
+        std::vector<AsyncFileIO::WriteOp> ops;
+        ops.reserve(batchSize);
+        
+        bool more = true;
+        while (more) {
+            ops.clear();
+            size_t n = 0;
+            while (n < batchSize) {
+                const Record* record = stream.next();
+                if (!record) {
+                    more = false;
+                    break;
+                }
+                batch[n].id = record->id;
+                batch[n].data.assign(record->data.begin(), record->data.end());
+                recordSizes[record->id] = record->data.size();
+                ops.push_back({getRecordFileName(record->id), batch[n].data.data(), batch[n].data.size()});
+                ++n;
+            }
+            if (!ops.empty()) async->writeFiles(ops);
+        }
+        return;
+    }
+    
+    // this is slow but not much we can do - filesystem overhead dominates
+    OpLap timer = lap(OpType::Write);
+    while (const Record* record = stream.next()) {
+        timer.restart();
+        recordSizes[record->id] = record->data.size();
         
-        std::ofstream out(getRecordFileName(record.id), std::ios::binary);
+        std::ofstream out(getRecordFileName(record->id), std::ios::binary);
         if (!out) throw std::runtime_error("couldnt create record file");
-        out.write(record.data.data(), record.data.size());
+        out.write(record->data.data(), record->data.size());
+        out.close();
+        timer.mark();
+    }
+}
+
+void IndividualFileStrategy::startWrite(size_t numRecords) {
+    totalRecords = numRecords;
+    recordSizes.assign(numRecords, 0);
+    
+    ensureSubdirectories(totalRecords);
+    if (blockCache) {
+        for (size_t i = 0; i < numRecords; ++i) forgetCached(getRecordFileName(static_cast<int>(i)));
     }
 }
 
@@ -51,6 +109,18 @@ std::vector<Record> IndividualFileStrategy::readSequential() {
     std::vector<Record> records;
     records.reserve(totalRecords);
     
+    if (async) {
+        std::vector<AsyncFileIO::ReadOp> ops;
+        ops.reserve(totalRecords);
+        for (size_t i = 0; i < totalRecords; ++i) {
+            records.emplace_back(static_cast<int>(i), recordSizes[i]);
+            ops.push_back({getRecordFileName(i), records.back().data.data(), recordSizes[i]});
+        }
+        async->readFiles(ops);
+        return records;
+    }
+    
+    OpLap timer = lap(OpType::SeqRead);
     for (size_t i = 0; i < totalRecords; ++i) {
         size_t size = recordSizes[i];
         
@@ -60,6 +130,7 @@ std::vector<Record> IndividualFileStrategy::readSequential() {
         Record record(i, size);
         in.read(record.data.data(), size);
         records.push_back(std::move(record));
+        timer.mark();
     }
     
     return records;
@@ -69,21 +140,121 @@ std::vector<Record> IndividualFileStrategy::readRandom(const std::vector<int>& i
     std::vector<Record> records;
     records.reserve(indices.size());
     
+    if (async) {
+        std::vector<AsyncFileIO::ReadOp> ops;
+        ops.reserve(indices.size());
+        for (int idx : indices) {
+            records.emplace_back(idx, recordSizes[idx]);
+            ops.push_back({getRecordFileName(idx), records.back().data.data(), recordSizes[idx]});
+        }
+        async->readFiles(ops);
+        return records;
+    }
+    
+    OpLap timer = lap(OpType::RandRead);
     for (int idx : indices) {
         size_t size = recordSizes[idx];
-        
-        std::ifstream in(getRecordFileName(idx), std::ios::binary);
-        if (!in) throw std::runtime_error("Failed to open record file");
-        
         Record record(idx, size);
-        in.read(record.data.data(), size);
+        
+        if (blockCache) {
+            std::ifstream in;
+            cachedRead(getRecordFileName(idx), in, 0, size, record.data.data());
+        } else {
+            std::ifstream in(getRecordFileName(idx), std::ios::binary);
+            if (!in) throw std::runtime_error("Failed to open record file");
+            in.read(record.data.data(), size);
+        }
         records.push_back(std::move(record));
+        timer.mark();
     }
     
     return records;
 }
 
+void IndividualFileStrategy::scanAsync(const std::vector<int>& ids, const RecordVisitor& visit) {
+    // read a batch of files into one buffer, hand out views, reuse the buffer
+    constexpr size_t batchSize = 4096;
+    std::vector<char> buffer;
+    std::vector<size_t> offsets;
+    std::vector<AsyncFileIO::ReadOp> ops;
+    
+    for (size_t start = 0; start < ids.size(); start += batchSize) {
+        size_t end = std::min(ids.size(), start + batchSize);
+        
+        offsets.clear();
+        size_t total = 0;
+        for (size_t i = start; i < end; ++i) {
+            offsets.push_back(total);
+            total += recordSizes[ids[i]];
+        }
+        if (buffer.size() < total) buffer.resize(total);
+        
+        ops.clear();
+        for (size_t i = start; i < end; ++i) {
+            int id = ids[i];
+            ops.push_back({getRecordFileName(id), buffer.data() + offsets[i - start], recordSizes[id]});
+        }
+        async->readFiles(ops);
+        
+        for (size_t i = start; i < end; ++i) {
+            visit(RecordView(ids[i], buffer.data() + offsets[i - start], recordSizes[ids[i]]));
+        }
+    }
+}
+
+void IndividualFileStrategy::scanSequential(const RecordVisitor& visit) {
+    if (async) {
+        std::vector<int> ids(totalRecords);
+        for (size_t i = 0; i < totalRecords; ++i) ids[i] = static_cast<int>(i);
+        scanAsync(ids, visit);
+        return;
+    }
+    
+    std::vector<char> scratch;
+    
+    for (size_t i = 0; i < totalRecords; ++i) {
+        size_t size = recordSizes[i];
+        
+        std::ifstream in(getRecordFileName(i), std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open record file");
+        
+        if (scratch.size() < size) scratch.resize(size);
+        in.read(scratch.data(), size);
+        visit(RecordView(static_cast<int>(i), scratch.data(), size));
+    }
+}
+
+void IndividualFileStrategy::scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) {
+    if (async) {
+        scanAsync(indices, visit);
+        return;
+    }
+    
+    std::vector<char> scratch;
+    
+    for (int idx : indices) {
+        size_t size = recordSizes[idx];
+        if (scratch.size() < size) scratch.resize(size);
+        
+        if (blockCache) {
+            std::ifstream in;
+            cachedRead(getRecordFileName(idx), in, 0, size, scratch.data());
+            visit(RecordView(idx, scratch.data(), size));
+            continue;
+        }
+        
+        std::ifstream in(getRecordFileName(idx), std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open record file");
+        
+        in.read(scratch.data(), size);
+        visit(RecordView(idx, scratch.data(), size));
+    }
+}
+
 void IndividualFileStrategy::cleanUp() {
+    if (blockCache) {
+        for (size_t i = 0; i < totalRecords; ++i) forgetCached(getRecordFileName(static_cast<int>(i)));
+    }
     fs::remove_all(baseDir);
 }
 
@@ -1,17 +1,29 @@
 #pragma once
 #include "StorageStrategy.h"
+#include "AsyncFileIO.h"
 #include <vector>
+#include <memory>
 
 // One file per record. Splits into subdirs to avoid huge flat directories.
+// Only the Sync engine records per-record latencies; the async engines
+// don't see individual completions.
 class IndividualFileStrategy : public StorageStrategy {
 public:
-    IndividualFileStrategy(const std::string& dir);
+    // queueDepth is how many files the async engines keep in flight
+    IndividualFileStrategy(const std::string& dir, IoEngine engine = IoEngine::Sync,
+                           size_t queueDepth = 256);
     
     void write(const std::vector<Record>& records) override;
+    void writeStream(RecordStream& stream) override;
+    bool supportsStreaming() const override { return true; }
     std::vector<Record> readSequential() override;
     std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void scanSequential(const RecordVisitor& visit) override;
+    void scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) override;
     void cleanUp() override;
-    std::string getName() const override { return "Individual"; }
+    std::string getName() const override {
+        return async ? "Individual(" + async->name() + ")" : "Individual";
+    }
     
     size_t getDiskSpaceUsed() const override;
     size_t getNumFiles() const override { return totalRecords; }
@@ -19,7 +31,10 @@ public:
 private:
     size_t totalRecords;
     std::vector<size_t> recordSizes; // cached at write time
+    std::unique_ptr<AsyncFileIO> async; // null for plain synchronous I/O
     
     std::string getRecordFileName(int recordId) const;
     void ensureSubdirectories(size_t numRecords);
+    void startWrite(size_t numRecords);
+    void scanAsync(const std::vector<int>& ids, const RecordVisitor& visit);
 };
@@ -0,0 +1,127 @@
+#include "LatencyHistogram.h"
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DUNE_HAVE_TSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define DUNE_HAVE_TSC
+#endif
+
+namespace {
+#ifdef DUNE_HAVE_TSC
+double measureNanosPerTick() {
+    using Clock = std::chrono::steady_clock;
+    auto t0 = Clock::now();
+    uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto t1 = Clock::now();
+    uint64_t c1 = __rdtsc();
+    double nanos = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return c1 > c0 ? nanos / static_cast<double>(c1 - c0) : 1.0;
+}
+#endif
+}
+
+uint64_t OpClock::now() {
+#ifdef DUNE_HAVE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+uint64_t OpClock::toNanos(uint64_t ticks) {
+#ifdef DUNE_HAVE_TSC
+    static const double nanosPerTick = measureNanosPerTick();
+    return static_cast<uint64_t>(ticks * nanosPerTick);
+#else
+    return ticks;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() : buckets(numBuckets) {
+    OpClock::toNanos(0);  // calibrate now, not in the middle of a timed loop
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t v) {
+    if (v < 2 * subBuckets) return static_cast<size_t>(v);
+    int msb = 63;
+    while (!(v >> msb)) --msb;
+    int shift = msb - subBucketBits;
+    size_t sub = static_cast<size_t>(v >> shift) - subBuckets;
+    return 2 * subBuckets + static_cast<size_t>(shift - 1) * subBuckets + sub;
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket) {
+    if (bucket < 2 * subBuckets) return bucket;
+    size_t rel = bucket - 2 * subBuckets;
+    int shift = static_cast<int>(rel / subBuckets) + 1;
+    uint64_t sub = rel % subBuckets + subBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanos, std::memory_order_relaxed);
+    
+    uint64_t seen = maxValue.load(std::memory_order_relaxed);
+    while (nanos > seen && !maxValue.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        uint64_t n = other.buckets[i].load(std::memory_order_relaxed);
+        if (n) buckets[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    total.fetch_add(other.count(), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    
+    uint64_t theirs = other.max();
+    uint64_t seen = maxValue.load(std::memory_order_relaxed);
+    while (theirs > seen && !maxValue.compare_exchange_weak(seen, theirs, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    total = 0;
+    sum = 0;
+    maxValue = 0;
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    
+    uint64_t target = static_cast<uint64_t>(p / 100.0 * n + 0.5);
+    target = std::clamp<uint64_t>(target, 1, n);
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) return std::min(highestIn(i), max());
+    }
+    return max();
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    LatencySummary s;
+    s.count = count();
+    s.mean = mean() / 1000.0;
+    s.p50  = percentile(50.0) / 1000.0;
+    s.p90  = percentile(90.0) / 1000.0;
+    s.p99  = percentile(99.0) / 1000.0;
+    s.p999 = percentile(99.9) / 1000.0;
+    s.max  = max() / 1000.0;
+    return s;
+}
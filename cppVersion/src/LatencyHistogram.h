@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// cheap timestamps for per-record timing. On x86 this is the TSC
+// (calibrated against steady_clock the first time toNanos is called),
+// elsewhere steady_clock in nanoseconds.
+class OpClock {
+public:
+    static uint64_t now();
+    static uint64_t toNanos(uint64_t ticks);
+};
+
+// percentiles in microseconds
+struct LatencySummary {
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+// HDR-style log-linear histogram of nanosecond values: exact below 256ns,
+// then 128 linear sub-buckets per power of two, so any recorded value is
+// off by less than 1%. Buckets are atomic, so worker threads can record
+// into the same histogram.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+    
+    void record(uint64_t nanos);
+    // adds other's samples, for threads that each kept their own
+    void merge(const LatencyHistogram& other);
+    void reset();
+    
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+    double mean() const;
+    // smallest value that at least p (0-100) percent of samples are <= to
+    uint64_t percentile(double p) const;
+    LatencySummary summary() const;
+    
+private:
+    static constexpr int subBucketBits = 7;
+    static constexpr size_t subBuckets = size_t(1) << subBucketBits;
+    static constexpr size_t numBuckets = 2 * subBuckets + (63 - subBucketBits) * subBuckets;
+    
+    std::vector<std::atomic<uint64_t>> buckets;
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> maxValue{0};
+    
+    static size_t bucketOf(uint64_t v);
+    static uint64_t highestIn(size_t bucket);
+};
+
+enum class OpType { Write, SeqRead, RandRead };
+
+// one histogram per kind of record operation
+struct OpLatencies {
+    LatencyHistogram write;
+    LatencyHistogram seqRead;
+    LatencyHistogram randRead;
+    
+    LatencyHistogram& get(OpType op) {
+        switch (op) {
+        case OpType::Write:   return write;
+        case OpType::SeqRead: return seqRead;
+        default:              return randRead;
+        }
+    }
+};
+
+// Lap timer for a loop over records: each mark() charges the time since the
+// previous mark (or construction) to the record just finished, so a block
+// read or chunk load lands on the record that had to wait for it. Does
+// nothing without a histogram. One per thread.
+class OpLap {
+public:
+    explicit OpLap(LatencyHistogram* hist) : hist(hist), last(hist ? OpClock::now() : 0) {}
+    
+    void mark() {
+        if (!hist) return;
+        uint64_t now = OpClock::now();
+        hist->record(OpClock::toNanos(now - last));
+        last = now;
+    }
+    
+    // n records that completed together (one batched read), each gets an
+    // equal share of the lap
+    void markBatch(size_t n) {
+        if (!hist || n == 0) return;
+        uint64_t now = OpClock::now();
+        uint64_t each = OpClock::toNanos(now - last) / n;
+        for (size_t i = 0; i < n; ++i) hist->record(each);
+        last = now;
+    }
+    
+    // start the next record's lap here without recording anything, for
+    // loops that do untimed work (generating the record) in between
+    void restart() {
+        if (hist) last = OpClock::now();
+    }
+    
+private:
+    LatencyHistogram* hist;
+    uint64_t last;
+};
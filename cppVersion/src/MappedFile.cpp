@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        ptr = std::exchange(other.ptr, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+#ifdef _WIN32
+        fallback = std::move(other.fallback);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("Failed to open file for mapping: " + path);
+    fallback.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(fallback.data(), fallback.size());
+    ptr = fallback.data();
+    length = fallback.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open file for mapping: " + path);
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file for mapping: " + path);
+    }
+    
+    length = static_cast<size_t>(st.st_size);
+    // mmap rejects zero-length mappings, an empty file is just an empty view
+    if (length > 0) {
+        void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            throw std::runtime_error("mmap failed: " + path);
+        }
+        ptr = static_cast<const char*>(addr);
+    }
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+#endif
+    opened = true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    fallback.clear();
+    fallback.shrink_to_fit();
+#else
+    if (ptr) munmap(const_cast<char*>(ptr), length);
+#endif
+    ptr = nullptr;
+    length = 0;
+    opened = false;
+}
+
+void MappedFile::advise(Access access) const {
+#ifndef _WIN32
+    if (!ptr) return;
+    int advice = MADV_NORMAL;
+    if (access == Access::Sequential) advice = MADV_SEQUENTIAL;
+    if (access == Access::Random)     advice = MADV_RANDOM;
+    madvise(const_cast<char*>(ptr), length, advice);
+#else
+    (void)access;
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Read-only mapping of a whole file. On platforms without mmap the file is
+// just read into a heap buffer so callers don't need to care.
+class MappedFile {
+public:
+    enum class Access { Normal, Sequential, Random };
+    
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    
+    void open(const std::string& path);
+    void close();
+    void advise(Access access) const;
+    
+    bool isOpen() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    
+private:
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    std::vector<char> fallback;
+#endif
+};
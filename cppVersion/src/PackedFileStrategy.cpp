@@ -0,0 +1,596 @@
+#include "PackedFileStrategy.h"
+#include "Checksum.h"
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t frameMagic = 0x314b5044;    // "DPK1"
+constexpr uint32_t trailerMagic = 0x52444b50;  // "PKDR"
+constexpr size_t frameHeaderSize = 16;
+constexpr size_t dirEntrySize = 20;
+constexpr size_t trailerSize = 16;
+constexpr size_t bufferSize = 1024 * 1024;
+// sequential reads pull in whole runs of neighbouring records at once
+constexpr size_t windowBytes = 4 * 1024 * 1024;
+
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t nameLen;
+    uint16_t kind;
+};
+
+// fdatasync by path, `out` doesn't hand out its fd. A directory gets an
+// fsync so the files created in it stay; Windows can't do that part.
+void syncToDisk(const std::string& path, bool directory = false) {
+#ifdef _WIN32
+    if (directory) return;
+    int fd = _open(path.c_str(), _O_BINARY | _O_WRONLY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) throw std::runtime_error("Failed to open " + path + " for sync: " + std::strerror(errno));
+#ifdef _WIN32
+    int rc = _commit(fd);
+#elif defined(__APPLE__)
+    int rc = fsync(fd);
+#else
+    int rc = directory ? fsync(fd) : fdatasync(fd);
+#endif
+    int err = errno;
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    if (rc != 0) throw std::runtime_error("Failed to sync " + path + ": " + std::strerror(err));
+}
+
+FrameHeader parseHeader(const char* buf) {
+    FrameHeader h;
+    std::memcpy(&h.magic,   buf,      4);
+    std::memcpy(&h.size,    buf + 4,  4);
+    std::memcpy(&h.crc,     buf + 8,  4);
+    std::memcpy(&h.nameLen, buf + 12, 2);
+    std::memcpy(&h.kind,    buf + 14, 2);
+    return h;
+}
+
+size_t frameBytes(const std::string& name, size_t size) {
+    return frameHeaderSize + name.size() + size;
+}
+
+// record_N -> N, -1 for names that aren't records
+int recordId(const std::string& name) {
+    static const std::string prefix = "record_";
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) return -1;
+    long id = 0;
+    for (size_t i = prefix.size(); i < name.size(); ++i) {
+        if (name[i] < '0' || name[i] > '9') return -1;
+        id = id * 10 + (name[i] - '0');
+        if (id > std::numeric_limits<int>::max()) return -1;
+    }
+    return static_cast<int>(id);
+}
+}
+
+PackedFileStrategy::PackedFileStrategy(const std::string& dir, size_t packBytes)
+    : packBytes(packBytes), outBuffer(bufferSize) {
+    baseDir = dir;
+    fs::create_directories(dir);
+}
+
+PackedFileStrategy::~PackedFileStrategy() {
+    // leave a directory behind so the next open doesn't have to walk the pack
+    try {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (out.is_open()) writeDirectory();
+        out.close();
+    } catch (...) {
+    }
+}
+
+std::string PackedFileStrategy::recordName(int id) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "record_%06d", id);
+    return name;
+}
+
+std::string PackedFileStrategy::getPackFileName(size_t pack) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/pack_%05zu.pak", pack);
+    return baseDir + name;
+}
+
+void PackedFileStrategy::put(const std::string& name, const char* data, size_t size) {
+    if (name.size() > std::numeric_limits<uint16_t>::max())
+        throw std::invalid_argument("file name too long for a pack: " + std::to_string(name.size()) + " bytes");
+    if (size > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("file too large for a pack: " + std::to_string(size) + " bytes");
+    load();
+    
+    uint32_t crc = crc32c(data, size);
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t offset = 0;
+    appendFrame(Put, name, data, size, crc, offset);
+    
+    Location where{static_cast<uint32_t>(currentPack), static_cast<uint32_t>(size), offset, crc};
+    auto it = files.find(name);
+    if (it != files.end()) {
+        deadBytes += frameBytes(name, it->second.size);
+        it->second = where;
+    } else {
+        files.emplace(name, where);
+    }
+    currentDir[name] = {Put, where};
+}
+
+bool PackedFileStrategy::remove(const std::string& name) {
+    load();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = files.find(name);
+    if (it == files.end()) return false;
+    
+    uint64_t offset = 0;
+    appendFrame(Tombstone, name, nullptr, 0, 0, offset);
+    deadBytes += frameBytes(name, it->second.size) + frameBytes(name, 0);
+    files.erase(it);
+    currentDir[name] = {Tombstone, {static_cast<uint32_t>(currentPack), 0, offset, 0}};
+    return true;
+}
+
+std::vector<char> PackedFileStrategy::get(const std::string& name) {
+    Location where = locate(name);
+    std::vector<char> data(where.size);
+    readLocation(where, name, data.data());
+    return data;
+}
+
+bool PackedFileStrategy::contains(const std::string& name) {
+    load();
+    std::lock_guard<std::mutex> lock(mtx);
+    return files.count(name) != 0;
+}
+
+std::vector<std::string> PackedFileStrategy::list() {
+    load();
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<std::string> names;
+    names.reserve(files.size());
+    for (const auto& [name, where] : files) names.push_back(name);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+void PackedFileStrategy::flush() {
+    load();
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!out.is_open()) return;
+    writeDirectory();
+    sync();
+    
+    // the packs rolled over since the last flush() were only closed, and
+    // new pack files need their directory entry on disk too
+    unsyncedPacks.push_back(currentPack);
+    for (size_t pack : unsyncedPacks) syncToDisk(getPackFileName(pack));
+    if (newPacks) syncToDisk(baseDir, true);
+    unsyncedPacks.clear();
+    newPacks = false;
+}
+
+void PackedFileStrategy::write(const std::vector<Record>& records) {
+    VectorRecordStream stream(records);
+    writeStream(stream);
+}
+
+void PackedFileStrategy::writeStream(RecordStream& stream) {
+    // like every other strategy, a write replaces whatever was there
+    cleanUp();
+    files.reserve(stream.size());
+    loaded = true;
+    
+    OpLap timer = lap(OpType::Write);
+    while (const Record* record = stream.next()) {
+        timer.restart();
+        put(recordName(record->id), record->data.data(), record->data.size());
+        timer.mark();
+    }
+    flush();
+}
+
+std::vector<Record> PackedFileStrategy::readSequential() {
+    std::vector<Record> records;
+    OpLap timer = lap(OpType::SeqRead);
+    scanSequential([&](const RecordView& view) {
+        records.emplace_back(view.id, view.size);
+        std::memcpy(records.back().data.data(), view.data, view.size);
+        timer.mark();
+    });
+    return records;
+}
+
+void PackedFileStrategy::scanSequential(const RecordVisitor& visit) {
+    load();
+    std::vector<std::pair<int, Location>> wanted;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        sync();
+        wanted.reserve(files.size());
+        for (const auto& [name, where] : files) {
+            int id = recordId(name);
+            if (id >= 0) wanted.emplace_back(id, where);
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    
+    std::vector<char> window;
+    size_t i = 0;
+    while (i < wanted.size()) {
+        // records written in id order sit back to back, read them as one run
+        const Location& first = wanted[i].second;
+        size_t end = i + 1;
+        uint64_t runEnd = first.offset + first.size;
+        while (end < wanted.size()) {
+            const Location& next = wanted[end].second;
+            if (next.pack != first.pack || next.offset < runEnd ||
+                next.offset - runEnd > ReadPlanner::defaultMaxGap ||
+                next.offset + next.size - first.offset > windowBytes) break;
+            runEnd = next.offset + next.size;
+            ++end;
+        }
+        
+        window.resize(runEnd - first.offset);
+        fds.acquire(getPackFileName(first.pack))->readAt(window.data(), window.size(), first.offset);
+        for (; i < end; ++i) {
+            const auto& [id, where] = wanted[i];
+            const char* src = window.data() + (where.offset - first.offset);
+            if (checksums && crc32c(src, where.size) != where.crc)
+                throw std::runtime_error("checksum mismatch for " + recordName(id) + " in " + baseDir);
+            visit(RecordView(id, src, where.size));
+        }
+    }
+}
+
+std::vector<Record> PackedFileStrategy::readRandom(const std::vector<int>& indices) {
+    load();
+    std::vector<Location> wanted;
+    wanted.reserve(indices.size());
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        sync();
+        for (int idx : indices) {
+            auto it = files.find(recordName(idx));
+            if (it == files.end())
+                throw std::out_of_range("no file " + recordName(idx) + " in " + baseDir);
+            wanted.push_back(it->second);
+        }
+    }
+    
+    std::vector<Record> records;
+    records.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) records.emplace_back(indices[i], wanted[i].size);
+    
+    OpLap timer = lap(OpType::RandRead);
+    if (coalesce) {
+        // one planned batch per pack touched
+        std::unordered_map<uint32_t, std::vector<ReadPlanner::Request>> byPack;
+        for (size_t i = 0; i < wanted.size(); ++i) {
+            byPack[wanted[i].pack].push_back({wanted[i].offset, wanted[i].size, records[i].data.data()});
+        }
+        for (auto& [pack, requests] : byPack) {
+            std::string path = getPackFileName(pack);
+            ReadPlanner::read(fds.acquire(path)->fd(), path, requests, coalesceGap,
+                              [&](const ReadPlanner::Span& span) { timer.markBatch(span.count); });
+        }
+    } else {
+        for (size_t i = 0; i < wanted.size(); ++i) {
+            timer.restart();
+            fds.acquire(getPackFileName(wanted[i].pack))
+                ->readAt(records[i].data.data(), wanted[i].size, wanted[i].offset);
+            timer.mark();
+        }
+    }
+    
+    for (size_t i = 0; i < wanted.size(); ++i) {
+        if (checksums && crc32c(records[i].data.data(), wanted[i].size) != wanted[i].crc)
+            throw std::runtime_error("checksum mismatch for " + recordName(indices[i]) + " in " + baseDir);
+    }
+    return records;
+}
+
+Record PackedFileStrategy::readOne(int id) {
+    std::string name = recordName(id);
+    Location where = locate(name);
+    Record record(id, where.size);
+    readLocation(where, name, record.data.data());
+    return record;
+}
+
+void PackedFileStrategy::update(int id, const std::vector<char>& data) {
+    std::string name = recordName(id);
+    if (!contains(name)) throw std::out_of_range("no file " + name + " in " + baseDir);
+    put(name, data.data(), data.size());
+}
+
+void PackedFileStrategy::append(const std::vector<Record>& records) {
+    for (const auto& record : records) put(recordName(record.id), record.data.data(), record.data.size());
+    flush();
+}
+
+void PackedFileStrategy::remove(int id) {
+    std::string name = recordName(id);
+    if (!remove(name)) throw std::out_of_range("no file " + name + " in " + baseDir);
+}
+
+void PackedFileStrategy::cleanUp() {
+    std::lock_guard<std::mutex> lock(mtx);
+    out.close();
+    fds.clear();
+    // packs left by an earlier run count too, not just the ones this object saw
+    for (size_t pack = 0; pack < numPacks || fs::exists(getPackFileName(pack)); ++pack) {
+        forgetCached(getPackFileName(pack));
+        fs::remove(getPackFileName(pack));
+    }
+    files.clear();
+    currentDir.clear();
+    numPacks = 0;
+    currentPack = 0;
+    currentBytes = 0;
+    lastDirectoryBytes = 0;
+    unsyncedPacks.clear();
+    newPacks = false;
+    deadBytes = 0;
+    dirty = false;
+    loaded = false;
+}
+
+size_t PackedFileStrategy::getDiskSpaceUsed() const {
+    size_t total = 0;
+    for (size_t pack = 0; pack < numPacks; ++pack) {
+        std::error_code ec;
+        size_t size = fs::file_size(getPackFileName(pack), ec);
+        if (!ec) total += size;
+    }
+    return total;
+}
+
+FileHandleStats PackedFileStrategy::getFileHandleStats() const {
+    auto stats = fds.stats();
+    return {stats.opens, stats.reuses, stats.evictions};
+}
+
+void PackedFileStrategy::load() {
+    if (loaded) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    if (loaded) return;
+    
+    files.clear();
+    numPacks = 0;
+    while (fs::exists(getPackFileName(numPacks))) ++numPacks;
+    
+    size_t total = 0;
+    size_t live = 0;
+    for (size_t pack = 0; pack < numPacks; ++pack) {
+        live += loadPack(pack);
+        total += fs::file_size(getPackFileName(pack));
+    }
+    // whatever the live files and the packs' current directories don't account for
+    
+    for (const auto& [name, where] : files) live += frameBytes(name, where.size);
+    deadBytes = total > live ? total - live : 0;
+    
+    // new frames go in a fresh pack, the existing ones are left as they are
+    out.close();
+    currentDir.clear();
+    loaded = true;
+}
+
+size_t PackedFileStrategy::loadPack(size_t pack) {
+    std::string path = getPackFileName(pack);
+    auto file = fds.acquire(path);
+    size_t size = file->size();
+    std::unordered_map<std::string, DirEntry> dir;
+    
+    // the trailer, if the pack was flushed, says where the directory is
+    bool found = false;
+    size_t directoryBytes = 0;
+    if (size >= frameHeaderSize + trailerSize) {
+        char trailer[trailerSize];
+        file->readAt(trailer, trailerSize, size - trailerSize);
+        uint64_t frameOffset;
+        uint32_t count, magic;
+        std::memcpy(&frameOffset, trailer,      8);
+        std::memcpy(&count,       trailer + 8,  4);
+        std::memcpy(&magic,       trailer + 12, 4);
+        
+        if (magic == trailerMagic && frameOffset + frameHeaderSize + trailerSize <= size) {
+            char buf[frameHeaderSize];
+            file->readAt(buf, frameHeaderSize, frameOffset);
+            FrameHeader h = parseHeader(buf);
+            size_t payloadOffset = frameOffset + frameHeaderSize + h.nameLen;
+            if (h.magic == frameMagic && h.kind == Directory && payloadOffset + h.size == size) {
+                std::vector<char> payload(h.size);
+                file->readAt(payload.data(), payload.size(), payloadOffset);
+                found = crc32c(payload.data(), payload.size()) == h.crc;
+                directoryBytes = size - frameOffset;
+                
+                const char* p = payload.data();
+                const char* end = payload.data() + payload.size() - trailerSize;
+                for (uint32_t i = 0; found && i < count; ++i) {
+                    if (end - p < static_cast<ptrdiff_t>(dirEntrySize)) { found = false; break; }
+                    uint16_t nameLen, kind;
+                    DirEntry entry{};
+                    std::memcpy(&nameLen,               p,      2);
+                    std::memcpy(&kind,                  p + 2,  2);
+                    std::memcpy(&entry.where.size,      p + 4,  4);
+                    std::memcpy(&entry.where.offset,    p + 8,  8);
+                    std::memcpy(&entry.where.crc,       p + 16, 4);
+                    p += dirEntrySize;
+                    if (end - p < nameLen || (kind != Put && kind != Tombstone)) { found = false; break; }
+                    entry.kind = static_cast<Kind>(kind);
+                    entry.where.pack = static_cast<uint32_t>(pack);
+                    dir[std::string(p, nameLen)] = entry;
+                    p += nameLen;
+                }
+            }
+        }
+    }
+    
+    if (!found) {
+        dir.clear();
+        directoryBytes = 0;
+        scanPack(pack, dir);
+    }
+    for (const auto& [name, entry] : dir) apply(name, entry);
+    return directoryBytes;
+}
+
+void PackedFileStrategy::scanPack(size_t pack, std::unordered_map<std::string, DirEntry>& dir) {
+    std::string path = getPackFileName(pack);
+    auto file = fds.acquire(path);
+    size_t size = file->size();
+    std::vector<char> body;
+    
+    size_t at = 0;
+    while (at + frameHeaderSize <= size) {
+        char buf[frameHeaderSize];
+        file->readAt(buf, frameHeaderSize, at);
+        FrameHeader h = parseHeader(buf);
+        size_t next = at + frameHeaderSize + h.nameLen + h.size;
+        // a torn tail is where the pack ends
+        if (h.magic != frameMagic || h.kind > Directory || next > size) break;
+        
+        body.resize(h.nameLen + h.size);
+        file->readAt(body.data(), body.size(), at + frameHeaderSize);
+        if (crc32c(body.data() + h.nameLen, h.size) != h.crc) break;
+        if (h.kind != Directory) {
+            Location where{static_cast<uint32_t>(pack), h.size, at + frameHeaderSize + h.nameLen, h.crc};
+            dir[std::string(body.data(), h.nameLen)] = {static_cast<Kind>(h.kind), where};
+        }
+        at = next;
+    }
+}
+
+void PackedFileStrategy::apply(const std::string& name, const DirEntry& entry) {
+    if (entry.kind == Put) files[name] = entry.where;
+    else files.erase(name);
+}
+
+void PackedFileStrategy::appendFrame(Kind kind, const std::string& name, const char* data, size_t size,
+                                     uint32_t crc, uint64_t& payloadOffset) {
+    if (!out.is_open()) {
+        openPack(numPacks);
+    } else if (kind != Directory && currentBytes > 0 &&
+               currentBytes + frameBytes(name, size) > packBytes) {
+        writeDirectory();
+        openPack(currentPack + 1);
+    }
+    
+    char header[frameHeaderSize];
+    uint32_t size32 = static_cast<uint32_t>(size);
+    uint16_t nameLen = static_cast<uint16_t>(name.size());
+    uint16_t kind16 = kind;
+    std::memcpy(header,      &frameMagic, 4);
+    std::memcpy(header + 4,  &size32,     4);
+    std::memcpy(header + 8,  &crc,        4);
+    std::memcpy(header + 12, &nameLen,    2);
+    std::memcpy(header + 14, &kind16,     2);
+    
+    out.write(header, frameHeaderSize);
+    out.write(name.data(), name.size());
+    if (size > 0) out.write(data, size);
+    if (!out) throw std::runtime_error("Failed to write pack file: " + getPackFileName(currentPack));
+    
+    payloadOffset = currentBytes + frameHeaderSize + name.size();
+    currentBytes += frameBytes(name, size);
+    dirty = true;
+}
+
+void PackedFileStrategy::openPack(size_t pack) {
+    if (out.is_open()) unsyncedPacks.push_back(currentPack);
+    out.close();
+    std::string path = getPackFileName(pack);
+    fds.forget(path);
+    out.rdbuf()->pubsetbuf(outBuffer.data(), outBuffer.size());
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to open pack file for writing: " + path);
+    
+    currentPack = pack;
+    currentBytes = 0;
+    lastDirectoryBytes = 0;
+    currentDir.clear();
+    numPacks = std::max(numPacks, pack + 1);
+    newPacks = true;
+}
+
+void PackedFileStrategy::writeDirectory() {
+    std::vector<char> payload;
+    for (const auto& [name, entry] : currentDir) {
+        size_t at = payload.size();
+        payload.resize(at + dirEntrySize + name.size());
+        char* p = payload.data() + at;
+        uint16_t nameLen = static_cast<uint16_t>(name.size());
+        uint16_t kind = entry.kind;
+        std::memcpy(p,      &nameLen,             2);
+        std::memcpy(p + 2,  &kind,                2);
+        std::memcpy(p + 4,  &entry.where.size,    4);
+        std::memcpy(p + 8,  &entry.where.offset,  8);
+        std::memcpy(p + 16, &entry.where.crc,     4);
+        std::memcpy(p + dirEntrySize, name.data(), name.size());
+    }
+    
+    uint64_t frameOffset = currentBytes;
+    uint32_t count = static_cast<uint32_t>(currentDir.size());
+    size_t at = payload.size();
+    payload.resize(at + trailerSize);
+    std::memcpy(payload.data() + at,      &frameOffset,  8);
+    std::memcpy(payload.data() + at + 8,  &count,        4);
+    std::memcpy(payload.data() + at + 12, &trailerMagic, 4);
+    
+    uint64_t offset = 0;
+    appendFrame(Directory, "", payload.data(), payload.size(),
+                crc32c(payload.data(), payload.size()), offset);
+    // the previous directory of this pack is superseded
+    deadBytes += lastDirectoryBytes;
+    lastDirectoryBytes = frameBytes("", payload.size());
+}
+
+void PackedFileStrategy::sync() {
+    if (!dirty) return;
+    out.flush();
+    if (!out) throw std::runtime_error("Failed to write pack file: " + getPackFileName(currentPack));
+    dirty = false;
+}
+
+PackedFileStrategy::Location PackedFileStrategy::locate(const std::string& name) {
+    load();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = files.find(name);
+    if (it == files.end()) throw std::out_of_range("no file " + name + " in " + baseDir);
+    sync();
+    return it->second;
+}
+
+void PackedFileStrategy::readLocation(const Location& where, const std::string& name, char* dest) {
+    fds.acquire(getPackFileName(where.pack))->readAt(dest, where.size, where.offset);
+    if (checksums && crc32c(dest, where.size) != where.crc)
+        throw std::runtime_error("checksum mismatch for " + name + " in " + baseDir);
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "StorageStrategy.h"
+#include "FdCache.h"
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Small named files packed into a few big pack files instead of one file
+// (and one inode) each. Every pack is a run of frames:
+//
+//   [uint32 magic][uint32 size][uint32 crc32c(payload)][uint16 nameLen][uint16 kind][name][payload]
+//
+// in native byte order, where kind is a put, a tombstone (remove, no
+// payload) or a directory. A directory frame lists the last put/tombstone
+// of every name in its pack with offset and size, and ends in a 16 byte
+// trailer [uint64 frame offset][uint32 entries][uint32 magic] - so when a
+// pack ends in a trailer, opening it is one read at the end instead of a
+// walk over the frames. flush() appends a fresh directory to the current
+// pack; packs without one (a crash before flush) are recovered by walking
+// the frames up to the first torn one.
+//
+// Packs roll over at packBytes. The name -> (pack, offset, size) map lives
+// in memory and is rebuilt on first use, so there are no directory walks
+// or per-record opens. Replaced and removed payloads stay in the packs as
+// dead bytes.
+//
+// Through the StorageStrategy interface record N is the file "record_N".
+class PackedFileStrategy : public StorageStrategy {
+public:
+    PackedFileStrategy(const std::string& dir, size_t packBytes = 64 * 1024 * 1024);
+    ~PackedFileStrategy();
+    
+    // Adds or replaces a file. Visible to get() right away, on disk for
+    // good once flush() has written the directory. Throws
+    // std::invalid_argument for names over 64KB or payloads over 4GB.
+    void put(const std::string& name, const char* data, size_t size);
+    // Appends a tombstone. False if there was no such file.
+    bool remove(const std::string& name);
+    // throws std::out_of_range if there's no such file
+    std::vector<char> get(const std::string& name);
+    bool contains(const std::string& name);
+    std::vector<std::string> list();
+    // writes the current pack's directory and fdatasyncs every pack
+    // written to since the last flush()
+    void flush();
+    
+    void write(const std::vector<Record>& records) override;
+    void writeStream(RecordStream& stream) override;
+    bool supportsStreaming() const override { return true; }
+    bool storesChecksums() const override { return true; }
+    std::vector<Record> readSequential() override;
+    std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void scanSequential(const RecordVisitor& visit) override;
+    Record readOne(int id) override;
+    // put/remove of recordName(id)
+    void update(int id, const std::vector<char>& data) override;
+    void remove(int id) override;
+    // puts + one flush(), so not all-or-nothing: readers see each record
+    // as it goes in
+    void append(const std::vector<Record>& records) override;
+    bool supportsUpdates() const override { return true; }
+    void cleanUp() override;
+    std::string getName() const override { return "Packed"; }
+    
+    size_t getDiskSpaceUsed() const override;
+    size_t getNumFiles() const override { return numPacks; }
+    FileHandleStats getFileHandleStats() const override;
+    // payload and frame bytes no live file points at any more
+    size_t getDeadBytes() const override { return deadBytes; }
+    
+    static std::string recordName(int id);
+    
+private:
+    enum Kind : uint16_t { Put = 0, Tombstone = 1, Directory = 2 };
+    
+    struct Location {
+        uint32_t pack;
+        uint32_t size;
+        uint64_t offset;   // of the payload
+        uint32_t crc;
+    };
+    
+    // what a pack's directory says about one name
+    struct DirEntry {
+        Kind kind;
+        Location where;
+    };
+    
+    size_t packBytes;
+    std::unordered_map<std::string, Location> files;
+    
+    // the pack being appended to and what its directory will say
+    std::vector<char> outBuffer;  // before `out`, which writes through it until it closes
+    std::ofstream out;
+    size_t currentPack = 0;
+    size_t currentBytes = 0;
+    size_t lastDirectoryBytes = 0;  // frame size of the previous flush(), dead once superseded
+    bool dirty = false;             // frames written since the last flush of `out`
+    std::vector<size_t> unsyncedPacks;  // rolled over since the last flush(), not fdatasynced yet
+    bool newPacks = false;              // pack files created since the last flush()
+    std::unordered_map<std::string, DirEntry> currentDir;
+    
+    size_t numPacks = 0;
+    size_t deadBytes = 0;
+    FdCache fds{64};
+    
+    std::mutex mtx;
+    std::atomic<bool> loaded{false};
+    
+    std::string getPackFileName(size_t pack) const;
+    // rebuilds `files` from the packs on disk unless already in memory
+    void load();
+    // returns the size of the directory frame it used, 0 after a walk
+    size_t loadPack(size_t pack);
+    void scanPack(size_t pack, std::unordered_map<std::string, DirEntry>& dir);
+    void apply(const std::string& name, const DirEntry& entry);
+    
+    // the caller holds mtx
+    void appendFrame(Kind kind, const std::string& name, const char* data, size_t size,
+                     uint32_t crc, uint64_t& payloadOffset);
+    void openPack(size_t pack);
+    void writeDirectory();
+    // makes sure frames written so far are readable through the fd cache
+    void sync();
+    Location locate(const std::string& name);
+    void readLocation(const Location& where, const std::string& name, char* dest);
+};
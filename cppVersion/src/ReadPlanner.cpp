@@ -0,0 +1,177 @@
+#include "ReadPlanner.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <climits>
+#endif
+
+namespace {
+#ifdef IOV_MAX
+constexpr size_t maxIovecs = IOV_MAX;
+#else
+constexpr size_t maxIovecs = 1024;
+#endif
+
+bool sameRange(const ReadPlanner::Request& a, const ReadPlanner::Request& b) {
+    return a.offset == b.offset && a.size == b.size;
+}
+
+// closes the fd on the way out, exceptions included
+struct FileHandle {
+    int fd;
+    explicit FileHandle(const std::string& path) {
+#ifdef _WIN32
+        fd = _open(path.c_str(), _O_BINARY | _O_RDONLY);
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+#endif
+        if (fd < 0) throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    ~FileHandle() {
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+};
+}
+
+std::vector<ReadPlanner::Span> ReadPlanner::plan(std::vector<Request>& requests, size_t maxGap) {
+    std::stable_sort(requests.begin(), requests.end(),
+                     [](const Request& a, const Request& b) { return a.offset < b.offset; });
+    
+    std::vector<Span> spans;
+    size_t iovecs = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Request& r = requests[i];
+        if (!spans.empty()) {
+            Span& s = spans.back();
+            size_t end = s.offset + s.length;
+            if (sameRange(r, requests[i - 1])) {
+                ++s.count;  // duplicate, copied from the first one after the read
+                continue;
+            }
+            // merge if it starts after the span (no overlap) and close enough,
+            // worst case it costs two iovecs (gap + payload)
+            if (r.offset >= end && r.offset - end <= maxGap && iovecs + 2 <= maxIovecs) {
+                iovecs += (r.offset > end ? 2 : 1);
+                s.length = r.offset + r.size - s.offset;
+                ++s.count;
+                continue;
+            }
+        }
+        spans.push_back({r.offset, r.size, i, 1});
+        iovecs = 1;
+    }
+    return spans;
+}
+
+ReadPlanner::Stats ReadPlanner::read(const std::string& path, std::vector<Request>& requests,
+                                     size_t maxGap, const std::function<void(const Span&)>& onSpan) {
+    if (requests.empty()) return Stats{};
+    FileHandle file(path);
+    return read(file.fd, path, requests, maxGap, onSpan);
+}
+
+ReadPlanner::Stats ReadPlanner::read(int fd, const std::string& path, std::vector<Request>& requests,
+                                     size_t maxGap, const std::function<void(const Span&)>& onSpan) {
+    Stats stats;
+    stats.requests = requests.size();
+    if (requests.empty()) return stats;
+    
+    auto spans = plan(requests, maxGap);
+    
+#ifdef _WIN32
+    std::vector<char> bounce;
+    for (const Span& s : spans) {
+        bounce.resize(s.length);
+        _lseeki64(fd, static_cast<__int64>(s.offset), SEEK_SET);
+        size_t done = 0;
+        while (done < s.length) {
+            int n = _read(fd, bounce.data() + done, static_cast<unsigned>(s.length - done));
+            ++stats.calls;
+            if (n <= 0) throw std::runtime_error("short read from " + path);
+            done += static_cast<size_t>(n);
+        }
+        size_t payload = 0;
+        for (size_t i = s.first; i < s.first + s.count; ++i) {
+            const Request& r = requests[i];
+            std::memcpy(r.dest, bounce.data() + (r.offset - s.offset), r.size);
+            if (i == s.first || !sameRange(r, requests[i - 1])) payload += r.size;
+        }
+        stats.bytesRead += s.length;
+        stats.gapBytes += s.length - payload;
+        if (onSpan) onSpan(s);
+    }
+#else
+    // every gap iovec points at the same sink, its contents don't matter
+    size_t widestGap = 0;
+    for (const Span& s : spans) {
+        size_t pos = s.offset;
+        for (size_t i = s.first; i < s.first + s.count; ++i) {
+            if (requests[i].offset > pos) widestGap = std::max(widestGap, requests[i].offset - pos);
+            pos = std::max(pos, requests[i].offset + requests[i].size);
+        }
+    }
+    std::vector<char> gapSink(std::max<size_t>(widestGap, 1));
+    std::vector<iovec> iov;
+    
+    for (const Span& s : spans) {
+        iov.clear();
+        size_t pos = s.offset;
+        for (size_t i = s.first; i < s.first + s.count; ++i) {
+            const Request& r = requests[i];
+            if (i > s.first && sameRange(r, requests[i - 1])) continue;
+            if (r.offset > pos) {
+                iov.push_back({gapSink.data(), r.offset - pos});
+                stats.gapBytes += r.offset - pos;
+            }
+            iov.push_back({r.dest, r.size});
+            pos = r.offset + r.size;
+        }
+        
+        // preadv can come back short, pick up where it stopped
+        size_t done = 0;
+        size_t next = 0;
+        while (next < iov.size()) {
+            ssize_t n = preadv(fd, iov.data() + next,
+                               static_cast<int>(std::min(iov.size() - next, maxIovecs)),
+                               static_cast<off_t>(s.offset + done));
+            ++stats.calls;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("preadv failed on " + path + ": " + std::strerror(errno));
+            if (n == 0) throw std::runtime_error("short read from " + path);
+            
+            done += static_cast<size_t>(n);
+            size_t left = static_cast<size_t>(n);
+            while (next < iov.size() && left >= iov[next].iov_len) {
+                left -= iov[next].iov_len;
+                ++next;
+            }
+            if (left > 0) {
+                iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + left;
+                iov[next].iov_len -= left;
+            }
+        }
+        stats.bytesRead += done;
+        
+        for (size_t i = s.first + 1; i < s.first + s.count; ++i) {
+            if (sameRange(requests[i], requests[i - 1]))
+                std::memcpy(requests[i].dest, requests[i - 1].dest, requests[i].size);
+        }
+        if (onSpan) onSpan(s);
+    }
+#endif
+    
+    return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+
+// Turns a pile of small positioned reads on one file into as few preadv
+// calls as possible. Requests that are at most maxGap bytes apart (after
+// sorting by offset) are merged into one span; the gaps are read into a
+// throwaway buffer and everything else lands straight in each request's
+// destination, no intermediate copy.
+//
+// Windows has no preadv, there every span is one read into a bounce
+// buffer.
+class ReadPlanner {
+public:
+    struct Request {
+        size_t offset;
+        size_t size;
+        char* dest;
+    };
+    
+    // one preadv: requests [first, first + count) of the sorted list
+    struct Span {
+        size_t offset;
+        size_t length;   // payload plus gaps
+        size_t first;
+        size_t count;
+    };
+    
+    struct Stats {
+        size_t requests = 0;
+        size_t calls = 0;        // preadv syscalls, retries included
+        size_t bytesRead = 0;
+        size_t gapBytes = 0;     // read only to bridge two requests
+    };
+    
+    static constexpr size_t defaultMaxGap = 16 * 1024;
+    
+    // Sorts requests by offset and groups them. A request for exactly the
+    // same range as the one before it (the same record asked for twice)
+    // joins the span without a read of its own, see read().
+    static std::vector<Span> plan(std::vector<Request>& requests, size_t maxGap = defaultMaxGap);
+    
+    // plan + execute against path. onSpan (if set) is called as each span
+    // completes, for per-record timing. Throws std::runtime_error if the
+    // file can't be opened or ends before a request does.
+    static Stats read(const std::string& path, std::vector<Request>& requests,
+                      size_t maxGap = defaultMaxGap,
+                      const std::function<void(const Span&)>& onSpan = nullptr);
+    
+    // same against a descriptor that's already open (see FdCache). path is
+    // only for error messages.
+    static Stats read(int fd, const std::string& path, std::vector<Request>& requests,
+                      size_t maxGap = defaultMaxGap,
+                      const std::function<void(const Span&)>& onSpan = nullptr);
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 struct Record {
     int id;
@@ -10,13 +11,28 @@ struct Record {
     Record(int id, size_t size) : id(id), data(size) {}
 };
 
-// used by SingleFile and Chunked strategies for their on-disk index
+// non-owning view of a record payload, only valid as long as whatever
+// backs it (a mapping, a read buffer) is alive
+struct RecordView {
+    int id;
+    const char* data;
+    size_t size;
+    
+    RecordView() : id(0), data(nullptr), size(0) {}
+    RecordView(int id, const char* data, size_t size)
+        : id(id), data(data), size(size) {}
+};
+
+// in-memory index entry for SingleFile, Chunked and friends (on disk it's
+// packed much tighter, see IndexFile). checksum is the crc32c of the
+// payload, 0 when checksums are off
 struct IndexEntry {
     int recordId;
+    uint32_t checksum;
     size_t offset;
     size_t size;
     
-    IndexEntry() : recordId(0), offset(0), size(0) {}
-    IndexEntry(int id, size_t off, size_t sz) 
-        : recordId(id), offset(off), size(sz) {}
+    IndexEntry() : recordId(0), checksum(0), offset(0), size(0) {}
+    IndexEntry(int id, size_t off, size_t sz, uint32_t crc = 0)
+        : recordId(id), checksum(crc), offset(off), size(sz) {}
 };
@@ -0,0 +1,91 @@
+#include "RecordBatch.h"
+#include <algorithm>
+#include <cstring>
+
+RecordArena::RecordArena(size_t slabSize) : slabSize(std::max<size_t>(1, slabSize)) {}
+
+RecordArena::Slab& RecordArena::slabFor(size_t size) {
+    while (current < slabs.size() && slabs[current].size - slabs[current].used < size) ++current;
+    if (current == slabs.size()) {
+        size_t bytes = std::max(slabSize, size);
+        // new char[] instead of make_unique, which would zero the whole slab
+        slabs.push_back({std::unique_ptr<char[]>(new char[bytes]), bytes, 0});
+    }
+    return slabs[current];
+}
+
+char* RecordArena::allocate(size_t size) {
+    Slab& slab = slabFor(size);
+    char* ptr = slab.data.get() + slab.used;
+    slab.used += size;
+    return ptr;
+}
+
+void RecordArena::reserve(size_t bytes) {
+    slabFor(bytes);
+}
+
+void RecordArena::clear() {
+    for (auto& slab : slabs) slab.used = 0;
+    current = 0;
+}
+
+void RecordArena::release() {
+    slabs.clear();
+    current = 0;
+}
+
+size_t RecordArena::bytesUsed() const {
+    size_t total = 0;
+    for (const auto& slab : slabs) total += slab.used;
+    return total;
+}
+
+size_t RecordArena::bytesReserved() const {
+    size_t total = 0;
+    for (const auto& slab : slabs) total += slab.size;
+    return total;
+}
+
+void RecordBatch::reserve(size_t records, size_t bytes) {
+    entries.reserve(records);
+    slab.reserve(bytes);
+}
+
+char* RecordBatch::append(int id, size_t size) {
+    char* data = slab.allocate(size);
+    entries.emplace_back(id, data, size);
+    payloadBytes += size;
+    return data;
+}
+
+void RecordBatch::append(const RecordView& view) {
+    std::memcpy(append(view.id, view.size), view.data, view.size);
+}
+
+void RecordBatch::reorder(const std::vector<size_t>& order) {
+    std::vector<RecordView> reordered;
+    reordered.reserve(order.size());
+    payloadBytes = 0;
+    for (size_t i : order) {
+        reordered.push_back(entries[i]);
+        payloadBytes += entries[i].size;
+    }
+    entries = std::move(reordered);
+}
+
+std::vector<Record> RecordBatch::toRecords() const {
+    std::vector<Record> records;
+    records.reserve(entries.size());
+    for (const auto& view : entries) {
+        records.emplace_back(view.id, view.size);
+        std::memcpy(records.back().data.data(), view.data, view.size);
+    }
+    return records;
+}
+
+void RecordBatch::clear() {
+    entries.clear();
+    slab.clear();
+    payloadBytes = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Record.h"
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// Bump allocator for record payloads. Hands out pieces of a few big slabs
+// and drops them all at once, instead of one malloc/free per record.
+// clear() keeps the slabs for the next round, release() gives the memory
+// back. Pointers stay valid until either. Not thread safe.
+class RecordArena {
+public:
+    explicit RecordArena(size_t slabSize = 4 * 1024 * 1024);
+    
+    RecordArena(const RecordArena&) = delete;
+    RecordArena& operator=(const RecordArena&) = delete;
+    RecordArena(RecordArena&&) = default;
+    RecordArena& operator=(RecordArena&&) = default;
+    
+    // uninitialized, no particular alignment
+    char* allocate(size_t size);
+    // make sure the next `bytes` worth of allocate() calls fit in one slab
+    void reserve(size_t bytes);
+    void clear();
+    void release();
+    
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+    size_t slabCount() const { return slabs.size(); }
+    
+private:
+    struct Slab {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+    
+    size_t slabSize;
+    std::vector<Slab> slabs;
+    size_t current = 0;  // slab being filled, the ones after it are empty
+    
+    // first slab from current on with room for size bytes, adding one if needed
+    Slab& slabFor(size_t size);
+};
+
+// A list of records whose payloads all live in one RecordArena - the
+// allocation-free alternative to std::vector<Record>. Elements are
+// RecordViews into the arena, valid until clear() or the batch goes away.
+class RecordBatch {
+public:
+    RecordBatch() = default;
+    
+    // room for `records` records with `bytes` of payload between them
+    void reserve(size_t records, size_t bytes);
+    
+    // space for a new record's payload, for the caller to fill in
+    char* append(int id, size_t size);
+    void append(const RecordView& view);
+    
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    RecordView operator[](size_t i) const { return entries[i]; }
+    
+    // payload bytes across the elements, not counting arena slack
+    size_t bytes() const { return payloadBytes; }
+    const RecordArena& arena() const { return slab; }
+    
+    // element i becomes the old element order[i]. Only the views move, so
+    // this is cheap; repeats are fine and share the payload.
+    void reorder(const std::vector<size_t>& order);
+    
+    // copies out, for code that wants the owning type
+    std::vector<Record> toRecords() const;
+    
+    // keeps the arena's slabs for the next round
+    void clear();
+    
+private:
+    RecordArena slab;
+    std::vector<RecordView> entries;
+    size_t payloadBytes = 0;
+};
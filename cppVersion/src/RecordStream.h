@@ -0,0 +1,29 @@
+#pragma once
+#include "Record.h"
+#include <vector>
+#include <cstddef>
+
+// Records handed to a strategy one at a time, so a dataset never has to be
+// in memory all at once. Ids come in order, 0..size()-1, same as write()
+// expects. next() returns null after the last record; the record it
+// returns is only valid until the following call.
+class RecordStream {
+public:
+    virtual ~RecordStream() = default;
+    
+    virtual size_t size() const = 0;
+    virtual const Record* next() = 0;
+};
+
+// records that are already in memory
+class VectorRecordStream : public RecordStream {
+public:
+    explicit VectorRecordStream(const std::vector<Record>& records) : records(records) {}
+    
+    size_t size() const override { return records.size(); }
+    const Record* next() override { return pos < records.size() ? &records[pos++] : nullptr; }
+    
+private:
+    const std::vector<Record>& records;
+    size_t pos = 0;
+};
@@ -0,0 +1,245 @@
+#include "ResultWriter.h"
+#include "SystemUtils.h"
+#include "Checksum.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+std::string quote(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+// JSON has no inf/nan (a zero-time phase gives an infinite throughput)
+std::string num(double v) {
+    if (!std::isfinite(v)) return "null";
+    std::ostringstream ss;
+    ss << std::setprecision(10) << v;
+    return ss.str();
+}
+
+std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string latencyJson(const LatencySummary& l) {
+    return "{\"count\": " + std::to_string(l.count) +
+           ", \"mean_us\": " + num(l.mean) +
+           ", \"p50_us\": " + num(l.p50) +
+           ", \"p90_us\": " + num(l.p90) +
+           ", \"p99_us\": " + num(l.p99) +
+           ", \"p999_us\": " + num(l.p999) +
+           ", \"max_us\": " + num(l.max) + "}";
+}
+
+std::string statsJson(const SampleStats& s) {
+    return "{\"mean\": " + num(s.mean) + ", \"stddev\": " + num(s.stddev) +
+           ", \"ci95\": [" + num(s.ciLow) + ", " + num(s.ciHigh) + "]}";
+}
+
+std::string sizeDistName(SizeDistribution d) {
+    return d == SizeDistribution::LogNormal ? "lognormal" : "uniform";
+}
+}
+
+void ResultWriter::writeJson(const std::string& path, const BenchmarkConfig& config,
+                             const std::vector<StrategyRuns>& results,
+                             const std::vector<WorkloadMetrics>& workloads,
+                             const std::vector<ScalingMetrics>& scaling) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("cant open " + path + " for writing");
+    
+    out << "{\n";
+    out << "  \"host\": " << quote(SystemUtils::getHostName()) << ",\n";
+    out << "  \"system\": " << quote(SystemUtils::getSystemInfo()) << ",\n";
+    out << "  \"crc32c\": " << quote(crc32cHardware() ? "sse4.2" : "software") << ",\n";
+    
+    out << "  \"config\": {\n"
+        << "    \"records\": " << config.numRecords << ",\n"
+        << "    \"seed\": " << config.seed << ",\n"
+        << "    \"min_size\": " << config.minRecordSize << ",\n"
+        << "    \"max_size\": " << config.maxRecordSize << ",\n"
+        << "    \"size_dist\": " << quote(sizeDistName(config.sizeDist)) << ",\n"
+        << "    \"compressibility\": " << num(config.compressibility) << ",\n"
+        << "    \"streaming\": " << (config.streaming ? "true" : "false") << ",\n"
+        << "    \"generator\": \"" << (config.legacyGenerator && !config.streaming ? "mt19937" : "counter") << "\",\n"
+        << "    \"chunk_size\": " << config.recordsPerChunk << ",\n"
+        << "    \"threads\": " << config.threads << ",\n"
+        << "    \"cache_mb\": " << config.cacheMB << ",\n"
+        << "    \"checksums\": " << (config.checksums ? "true" : "false") << ",\n"
+        << "    \"coalesce_gap\": " << (config.coalesce ? std::to_string(config.coalesceGap) : "null") << ",\n"
+        << "    \"repetitions\": " << config.repetitions << ",\n"
+        << "    \"random_reads\": " << config.randomReads << ",\n"
+        << "    \"pattern_reads\": " << config.patternReads << "\n"
+        << "  },\n";
+    
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i ? ",\n" : "\n");
+        out << "    {\n";
+        out << "      \"strategy\": " << quote(r.strategy) << ",\n";
+        out << "      \"verified\": " << (r.allVerified() ? "true" : "false") << ",\n";
+        
+        out << "      \"summary\": {\n"
+            << "        \"write_s\": "    << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.writeTime; })) << ",\n"
+            << "        \"seqread_s\": "  << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.seqReadTime; })) << ",\n"
+            << "        \"randread_s\": " << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.randReadTime; })) << ",\n"
+            << "        \"scan_s\": "     << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.scanTime; })) << ",\n"
+            << "        \"randscan_s\": " << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.randScanTime; })) << ",\n"
+            << "        \"write_mbps\": " << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.writeThroughput(); })) << ",\n"
+            << "        \"seqread_mbps\": " << statsJson(r.stats([](const BenchmarkMetrics& m) { return m.seqReadThroughput(); })) << "\n"
+            << "      },\n";
+        
+        out << "      \"runs\": [";
+        for (size_t j = 0; j < r.runs.size(); ++j) {
+            const auto& m = r.runs[j];
+            out << (j ? ",\n" : "\n");
+            out << "        {\"rep\": " << j
+                << ", \"data_bytes\": " << m.totalDataSize
+                << ", \"write_s\": " << num(m.writeTime)
+                << ", \"seqread_s\": " << num(m.seqReadTime)
+                << ", \"seqread_batch_s\": " << num(m.seqReadBatchTime)
+                << ", \"randread_s\": " << num(m.randReadTime)
+                << ", \"scan_s\": " << num(m.scanTime)
+                << ", \"randscan_s\": " << num(m.randScanTime)
+                << ", \"disk_bytes\": " << m.diskSpaceUsed
+                << ", \"files\": " << m.numFiles
+                << ", \"padding_bytes\": " << m.paddingBytes
+                << ", \"syncs\": " << m.syncCount
+                << ", \"avg_commit_s\": " << num(m.avgCommitLatency)
+                << ", \"max_commit_s\": " << num(m.maxCommitLatency);
+            if (m.cacheEnabled) {
+                out << ", \"cache\": {\"hits\": " << m.cacheHits
+                    << ", \"misses\": " << m.cacheMisses
+                    << ", \"evictions\": " << m.cacheEvictions << "}";
+            }
+            if (m.updateLat.count > 0) {
+                out << ", \"updates\": {\"dead_bytes\": " << m.deadBytes
+                    << ", \"background_compactions\": " << m.backgroundCompactions;
+                if (m.compacted) {
+                    out << ", \"reclaimed_bytes\": " << m.reclaimedBytes
+                        << ", \"compact_s\": " << num(m.compactTime);
+                }
+                out << ", \"append_s\": " << num(m.appendTime) << "}";
+            }
+            if (m.fdOpens > 0) {
+                out << ", \"fds\": {\"opens\": " << m.fdOpens
+                    << ", \"reuses\": " << m.fdReuses
+                    << ", \"evictions\": " << m.fdEvictions << "}";
+            }
+            out << ",\n          \"latency\": {\"write\": " << latencyJson(m.writeLat)
+                << ",\n                      \"seqread\": " << latencyJson(m.seqReadLat)
+                << ",\n                      \"randread\": " << latencyJson(m.randReadLat)
+                << ",\n                      \"readone\": " << latencyJson(m.pointReadLat)
+                << ",\n                      \"update\": " << latencyJson(m.updateLat) << "}"
+                << ", \"verified\": " << (m.dataVerified ? "true" : "false") << "}";
+        }
+        out << "\n      ]\n    }";
+    }
+    out << "\n  ],\n";
+    
+    out << "  \"access_patterns\": [";
+    for (size_t i = 0; i < workloads.size(); ++i) {
+        const auto& w = workloads[i];
+        out << (i ? ",\n" : "\n");
+        out << "    {\"strategy\": " << quote(w.strategy)
+            << ", \"pattern\": " << quote(w.workload)
+            << ", \"reads\": " << w.reads
+            << ", \"distinct\": " << w.distinctRecords
+            << ", \"time_s\": " << num(w.readTime)
+            << ", \"hit_rate\": " << (w.cacheEnabled ? num(w.cacheHitRate) : "null")
+            << ", \"verified\": " << (w.dataVerified ? "true" : "false") << "}";
+    }
+    out << (workloads.empty() ? "],\n" : "\n  ],\n");
+    
+    out << "  \"read_scaling\": [";
+    for (size_t i = 0; i < scaling.size(); ++i) {
+        const auto& r = scaling[i];
+        out << (i ? ",\n" : "\n");
+        out << "    {\"strategy\": " << quote(r.strategy)
+            << ", \"threads\": " << r.threads
+            << ", \"writer\": " << (r.writer ? "true" : "false")
+            << ", \"writes\": " << r.writes
+            << ", \"reads\": " << r.reads
+            << ", \"time_s\": " << num(r.readTime)
+            << ", \"reads_per_s\": " << num(r.readsPerSecond())
+            << ", \"writes_per_s\": " << num(r.writesPerSecond())
+            << ",\n     \"latency\": " << latencyJson(r.lat)
+            << ",\n     \"thread_latency\": [";
+        for (size_t t = 0; t < r.threadLat.size(); ++t) {
+            out << (t ? ",\n                        " : "") << latencyJson(r.threadLat[t]);
+        }
+        out << "], \"verified\": " << (r.dataVerified ? "true" : "false") << "}";
+    }
+    out << (scaling.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+    
+    out.close();
+    if (!out) throw std::runtime_error("failed writing " + path);
+}
+
+void ResultWriter::writeCsv(const std::string& path, const std::vector<StrategyRuns>& results) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("cant open " + path + " for writing");
+    
+    out << "strategy,rep,data_bytes,write_s,seqread_s,randread_s,scan_s,randscan_s,"
+           "write_mbps,seqread_mbps,disk_bytes,files,padding_bytes,syncs,avg_commit_s,"
+           "cache_hits,cache_misses,cache_evictions,"
+           "write_p50_us,write_p99_us,write_p999_us,"
+           "seqread_p50_us,seqread_p99_us,seqread_p999_us,"
+           "randread_p50_us,randread_p99_us,randread_p999_us,"
+           "readone_p50_us,readone_p99_us,readone_p999_us,seqread_batch_s,"
+           "update_p50_us,update_p99_us,dead_bytes,compact_s,append_s,verified\n";
+    
+    for (const auto& r : results) {
+        for (size_t j = 0; j < r.runs.size(); ++j) {
+            const auto& m = r.runs[j];
+            out << csvField(r.strategy) << ',' << j << ',' << m.totalDataSize << ','
+                << num(m.writeTime) << ',' << num(m.seqReadTime) << ',' << num(m.randReadTime) << ','
+                << num(m.scanTime) << ',' << num(m.randScanTime) << ','
+                << num(m.writeThroughput()) << ',' << num(m.seqReadThroughput()) << ','
+                << m.diskSpaceUsed << ',' << m.numFiles << ',' << m.paddingBytes << ','
+                << m.syncCount << ',' << num(m.avgCommitLatency) << ','
+                << m.cacheHits << ',' << m.cacheMisses << ',' << m.cacheEvictions << ','
+                << num(m.writeLat.p50) << ',' << num(m.writeLat.p99) << ',' << num(m.writeLat.p999) << ','
+                << num(m.seqReadLat.p50) << ',' << num(m.seqReadLat.p99) << ',' << num(m.seqReadLat.p999) << ','
+                << num(m.randReadLat.p50) << ',' << num(m.randReadLat.p99) << ',' << num(m.randReadLat.p999) << ','
+                << num(m.pointReadLat.p50) << ',' << num(m.pointReadLat.p99) << ',' << num(m.pointReadLat.p999) << ','
+                << num(m.seqReadBatchTime) << ','
+                << num(m.updateLat.p50) << ',' << num(m.updateLat.p99) << ','
+                << m.deadBytes << ',' << (m.compacted ? num(m.compactTime) : "") << ','
+                << num(m.appendTime) << ','
+                << (m.dataVerified ? 1 : 0) << '\n';
+        }
+    }
+    
+    out.close();
+    if (!out) throw std::runtime_error("failed writing " + path);
+}
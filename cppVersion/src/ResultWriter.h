@@ -0,0 +1,21 @@
+#pragma once
+#include "BenchmarkMetrics.h"
+#include "BenchmarkConfig.h"
+#include <string>
+#include <vector>
+
+// Machine-readable results, so runs from different nodes can be diffed
+// without scraping the tables. Both throw std::runtime_error if the file
+// can't be written.
+class ResultWriter {
+public:
+    // config, host, every run of every strategy, per-strategy mean/stddev/CI
+    // of the timings, and the access pattern and read scaling sweeps
+    static void writeJson(const std::string& path, const BenchmarkConfig& config,
+                          const std::vector<StrategyRuns>& results,
+                          const std::vector<WorkloadMetrics>& workloads,
+                          const std::vector<ScalingMetrics>& scaling);
+    
+    // one row per strategy run
+    static void writeCsv(const std::string& path, const std::vector<StrategyRuns>& results);
+};
@@ -0,0 +1,169 @@
+#include "ShardedFileStrategy.h"
+#include "IndexFile.h"
+#include "WorkerPool.h"
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+ShardedFileStrategy::ShardedFileStrategy(const std::string& dir, size_t numThreads)
+    : numThreads(std::max<size_t>(1, numThreads)) {
+    baseDir = dir;
+    indexFile = dir + "/sharded_index.idx";
+    fs::create_directories(dir);
+    pool = std::make_unique<WorkerPool>(this->numThreads);
+}
+
+ShardedFileStrategy::~ShardedFileStrategy() = default;
+
+std::string ShardedFileStrategy::getShardFileName(size_t shard) const {
+    return baseDir + "/shard_" + std::to_string(shard) + ".dat";
+}
+
+size_t ShardedFileStrategy::shardOf(size_t pos) const {
+    auto it = std::upper_bound(shardStart.begin(), shardStart.end(), pos);
+    return static_cast<size_t>(it - shardStart.begin()) - 1;
+}
+
+void ShardedFileStrategy::write(const std::vector<Record>& records) {
+    numShards = numThreads;
+    shardStart.resize(numShards + 1);
+    for (size_t s = 0; s <= numShards; ++s) {
+        shardStart[s] = records.size() * s / numShards;
+    }
+    
+    index.clear();
+    index.resize(records.size());
+    
+    // each thread fills in the index slots for its own range, so the merged
+    // index needs no locking and doesn't depend on which thread finished first
+    pool->parallelFor(numShards, [&](size_t shard) {
+        std::ofstream out(getShardFileName(shard), std::ios::binary);
+        if (!out) throw std::runtime_error("Failed to open shard file");
+        
+        constexpr size_t bufferSize = 512 * 1024;
+        std::vector<char> buffer(bufferSize);
+        out.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
+        
+        size_t offset = 0;
+        OpLap timer = lap(OpType::Write);
+        for (size_t pos = shardStart[shard]; pos < shardStart[shard + 1]; ++pos) {
+            const auto& record = records[pos];
+            out.write(record.data.data(), record.data.size());
+            index[pos] = IndexEntry(record.id, offset, record.data.size());
+            offset += record.data.size();
+            timer.mark();
+        }
+        
+        out.close();
+        if (!out) throw std::runtime_error("Failed to write shard file");
+    });
+    
+    writeIndex();
+}
+
+std::vector<Record> ShardedFileStrategy::readSequential() {
+    readIndex();
+    std::vector<Record> records(index.size());
+    
+    pool->parallelFor(numShards, [&](size_t shard) {
+        std::ifstream in(getShardFileName(shard), std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open shard file");
+        
+        constexpr size_t bufferSize = 512 * 1024;
+        std::vector<char> buffer(bufferSize);
+        in.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
+        OpLap timer = lap(OpType::SeqRead);
+        
+        for (size_t pos = shardStart[shard]; pos < shardStart[shard + 1]; ++pos) {
+            const auto& entry = index[pos];
+            Record record(entry.recordId, entry.size);
+            in.read(record.data.data(), entry.size);
+            records[pos] = std::move(record);
+            timer.mark();
+        }
+        if (!in) throw std::runtime_error("short read from shard file");
+    });
+    
+    return records;
+}
+
+std::vector<Record> ShardedFileStrategy::readRandom(const std::vector<int>& indices) {
+    readIndex();
+    
+    // bucket the requests by shard, sorted by offset within each shard
+    std::vector<std::vector<std::pair<int, size_t>>> perShard(numShards);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        perShard[shardOf(indices[i])].emplace_back(indices[i], i);
+    }
+    
+    std::vector<Record> records(indices.size());
+    pool->parallelFor(numShards, [&](size_t shard) {
+        auto& requests = perShard[shard];
+        if (requests.empty()) return;
+        std::sort(requests.begin(), requests.end(),
+                  [this](const auto& a, const auto& b) {
+                      return index[a.first].offset < index[b.first].offset;
+                  });
+        
+        std::ifstream in(getShardFileName(shard), std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open shard file");
+        OpLap timer = lap(OpType::RandRead);
+        
+        for (const auto& [idx, origPos] : requests) {
+            const auto& entry = index[idx];
+            Record record(entry.recordId, entry.size);
+            in.seekg(entry.offset);
+            in.read(record.data.data(), entry.size);
+            records[origPos] = std::move(record);
+            timer.mark();
+        }
+        if (!in) throw std::runtime_error("short read from shard file");
+    });
+    
+    return records;
+}
+
+void ShardedFileStrategy::writeIndex() {
+    // shard boundaries ride along as aux values
+    IndexFile::Contents contents;
+    contents.entries = &index;
+    contents.checksums = false;
+    contents.aux.assign(shardStart.begin(), shardStart.end());
+    IndexFile::write(indexFile, contents);
+}
+
+void ShardedFileStrategy::readIndex() {
+    IndexFile file(indexFile);
+    if (file.auxCount() < 2) throw std::runtime_error("not a sharded index: " + indexFile);
+    file.decode(index);
+    numShards = file.auxCount() - 1;
+    shardStart.resize(file.auxCount());
+    for (size_t s = 0; s < shardStart.size(); ++s) shardStart[s] = static_cast<size_t>(file.aux(s));
+}
+
+void ShardedFileStrategy::cleanUp() {
+    for (size_t i = 0; i < numShards; ++i) {
+        fs::remove(getShardFileName(i));
+    }
+    fs::remove(indexFile);
+}
+
+size_t ShardedFileStrategy::getDiskSpaceUsed() const {
+    size_t total = 0;
+    
+    for (size_t i = 0; i < numShards; ++i) {
+        std::string filename = getShardFileName(i);
+        if (fs::exists(filename)) {
+            total += fs::file_size(filename);
+        }
+    }
+    
+    if (fs::exists(indexFile)) {
+        total += fs::file_size(indexFile);
+    }
+    
+    return total;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "StorageStrategy.h"
+#include <vector>
+#include <memory>
+
+class WorkerPool;
+
+// One data file per writer thread plus one merged index. Records are split
+// into contiguous ranges, thread i writes range i to shard_i.dat, and reads
+// fan out over the shards the same way.
+class ShardedFileStrategy : public StorageStrategy {
+public:
+    ShardedFileStrategy(const std::string& dir, size_t numThreads = 4);
+    ~ShardedFileStrategy() override;
+    
+    void write(const std::vector<Record>& records) override;
+    std::vector<Record> readSequential() override;
+    std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void cleanUp() override;
+    std::string getName() const override {
+        return "Sharded(" + std::to_string(numThreads) + ")";
+    }
+    
+    size_t getDiskSpaceUsed() const override;
+    size_t getNumFiles() const override { return numShards + 1; }
+    
+private:
+    size_t numThreads;
+    size_t numShards = 0;
+    std::string indexFile;
+    std::unique_ptr<WorkerPool> pool;
+    
+    // index[pos] is the record at position pos, offsets are within its shard.
+    // shard s holds positions [shardStart[s], shardStart[s + 1]).
+    std::vector<IndexEntry> index;
+    std::vector<size_t> shardStart;
+    
+    std::string getShardFileName(size_t shard) const;
+    size_t shardOf(size_t pos) const;
+    void writeIndex();
+    void readIndex();
+};
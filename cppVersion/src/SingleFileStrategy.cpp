@@ -1,66 +1,224 @@
 #include "SingleFileStrategy.h"
+#include "DirectFile.h"
 #include <fstream>
 #include <filesystem>
 #include <stdexcept>
 #include <algorithm>
+#include <optional>
+#include <memory>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
-SingleFileStrategy::SingleFileStrategy(const std::string& dir) {
+namespace {
+// 4MB buffer - tried smaller values but this was fastest on my machine
+constexpr size_t bufferSize = 4 * 1024 * 1024;
+
+// the log isn't folded into the index before it has this many entries,
+// so small stores don't rewrite their index every few appends
+constexpr size_t minFoldEntries = 4096;
+
+// the owning read API still has to hand out copies, but at least they come
+// straight out of the mapping instead of through read() syscalls. The page
+// faults happen here, so this is where the per-record time goes.
+std::vector<Record> copyViews(const std::vector<RecordView>& views, OpLap timer) {
+    std::vector<Record> records;
+    records.reserve(views.size());
+    for (const auto& view : views) {
+        records.emplace_back(view.id, view.size);
+        std::copy(view.data, view.data + view.size, records.back().data.data());
+        timer.mark();
+    }
+    return records;
+}
+}
+
+SingleFileStrategy::SingleFileStrategy(const std::string& dir, IoMode mode)
+    : mode(mode), bufferPool(bufferSize) {
     baseDir = dir;
-    dataFile = dir + "/single_data.dat";
+    dataFile = dataFileFor(0);
     indexFile = dir + "/single_index.idx";
+    logFile = dir + "/single_index.log";
     fs::create_directories(dir);
 }
 
+SingleFileStrategy::~SingleFileStrategy() {
+    try {
+        waitForCompaction();
+    } catch (...) {
+    }
+}
+
+std::string SingleFileStrategy::dataFileFor(uint64_t gen) const {
+    if (gen == 0) return baseDir + "/single_data.dat";
+    return baseDir + "/single_data." + std::to_string(gen) + ".dat";
+}
+
+void SingleFileStrategy::resetGeneration() {
+    waitForCompaction();
+    // nothing reads while write() or cleanUp() runs, so the snapshots can
+    // go now, and with them the files compactions left for them; also the
+    // mappings, truncating a mapped file would SIGBUS any old views
+    current.reset();
+    mapping.reset();
+    epoch.reset();
+    appendOut.close();
+    log.close();
+    fs::remove(logFile);
+    // every compacted generation's data file, not only the one in use: a
+    // fresh instance on a compacted directory hasn't read the index yet
+    std::vector<std::string> stale;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(baseDir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name != "single_data.dat" && name.rfind("single_data.", 0) == 0 &&
+            name.size() > 4 && name.compare(name.size() - 4, 4, ".dat") == 0) {
+            stale.push_back(baseDir + "/" + name);
+        }
+    }
+    for (const auto& path : stale) {
+        forgetCached(path);
+        fs::remove(path);
+    }
+    generation = 0;
+    dataGeneration = 0;
+    dataFile = dataFileFor(0);
+    deadBytes = 0;
+}
+
 void SingleFileStrategy::write(const std::vector<Record>& records) {
-    std::ofstream out(dataFile, std::ios::binary);
-    if (!out) throw std::runtime_error("cant open data file");
-    
-    // 4MB buffer - tried smaller values but this was fastest on my machine
-    constexpr size_t bufferSize = 4 * 1024 * 1024;
-    std::vector<char> buffer(bufferSize);
-    out.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
-    
-    index.clear();
-    index.reserve(records.size());
+    VectorRecordStream stream(records);
+    writeStream(stream);
+}
+
+void SingleFileStrategy::writeStream(RecordStream& stream) {
+    resetGeneration();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    forgetCached(dataFile);
+    fds.clear();
+    indexLoaded = false;
+    indexChecksums = checksums;
     
-    size_t currentOffset = 0;
-    for (const auto& record : records) {
-        out.write(record.data.data(), record.data.size());
-        index.emplace_back(record.id, currentOffset, record.data.size());
-        currentOffset += record.data.size();
+    std::vector<IndexEntry> entries;
+    entries.reserve(stream.size());
+    if (mode == IoMode::Direct) {
+        writeDirect(stream, entries);
+        dataEnd = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+    } else {
+        std::ofstream out(dataFile, std::ios::binary);
+        if (!out) throw std::runtime_error("cant open data file");
+        
+        std::vector<char> buffer(bufferSize);
+        out.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
+        
+        size_t currentOffset = 0;
+        OpLap timer = lap(OpType::Write);
+        while (const Record* record = stream.next()) {
+            timer.restart();
+            out.write(record->data.data(), record->data.size());
+            entries.emplace_back(record->id, currentOffset, record->data.size(),
+                                 recordChecksum(record->data.data(), record->data.size()));
+            currentOffset += record->data.size();
+            timer.mark();
+        }
+        
+        out.close();
+        dataEnd = currentOffset;
     }
     
-    out.close();
-    writeIndex();
+    writeIndex(entries, generation, dataGeneration);
+    // index is already what's on disk
+    index.assign(entries);
+    mapping.reset();
+    epoch = std::make_shared<SnapshotEpoch>();
+    publish();
+    indexLoaded = true;
 }
 
 std::vector<Record> SingleFileStrategy::readSequential() {
-    readIndex();
-    std::ifstream in(dataFile, std::ios::binary);
+    if (mode == IoMode::Mmap) {
+        auto snap = snapshot();
+        return copyViews(viewSequential(*snap, mapped(*snap)), lap(OpType::SeqRead));
+    }
+    
+    if (mode == IoMode::Direct) {
+        std::vector<Record> records;
+        OpLap timer = lap(OpType::SeqRead);
+        scanSequential([&](const RecordView& view) {
+            records.emplace_back(view.id, view.size);
+            std::memcpy(records.back().data.data(), view.data, view.size);
+            timer.mark();
+        });
+        return records;
+    }
+    
+    auto snap = snapshot();
+    const auto& entries = snap->index;
+    std::ifstream in(snap->dataFile, std::ios::binary);
     if (!in) throw std::runtime_error("Failed to open data file for reading");
     
-    constexpr size_t bufferSize = 4 * 1024 * 1024;
     std::vector<char> buffer(bufferSize);
     in.rdbuf()->pubsetbuf(buffer.data(), bufferSize);
     
     std::vector<Record> records;
-    records.reserve(index.size());
+    records.reserve(entries.size());
     
-    for (const auto& entry : index) {
+    OpLap timer = lap(OpType::SeqRead);
+    size_t position = 0;
+    for (const auto& entry : entries) {
+        if (entry.recordId == IndexFile::removed) continue;
+        // only records moved by update() break the back to back layout
+        if (entry.offset != position) in.seekg(entry.offset);
+        position = entry.offset + entry.size;
         Record record(entry.recordId, entry.size);
-        in.read(record.data.data(), entry.size);
+        if (!in.read(record.data.data(), entry.size))
+            throw std::runtime_error("short read from data file");
+        verifyChecksum(entry, entry.recordId, record.data.data());
         records.push_back(std::move(record));
+        timer.mark();
     }
     
     return records;
 }
 
 std::vector<Record> SingleFileStrategy::readRandom(const std::vector<int>& indices) {
-    readIndex();
-    std::ifstream in(dataFile, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open data file for reading");
+    auto snap = snapshot();
+    if (mode == IoMode::Mmap) {
+        return copyViews(viewRandom(*snap, mapped(*snap), indices), lap(OpType::RandRead));
+    }
+    
+    const auto& entries = snap->index;
+    const std::string& path = snap->dataFile;
+    for (int idx : indices) liveEntry(entries, idx);
+    if (mode == IoMode::Buffered && !blockCache && coalesce) {
+        std::vector<Record> records;
+        records.reserve(indices.size());
+        std::vector<ReadPlanner::Request> requests;
+        requests.reserve(indices.size());
+        for (int idx : indices) {
+            const auto& entry = entries[idx];
+            records.emplace_back(entry.recordId, entry.size);
+            requests.push_back({entry.offset, entry.size, records.back().data.data()});
+        }
+        
+        OpLap timer = lap(OpType::RandRead);
+        ReadPlanner::read(fds.acquire(path)->fd(), path, requests, coalesceGap,
+                          [&](const ReadPlanner::Span& span) { timer.markBatch(span.count); });
+        for (size_t i = 0; i < indices.size(); ++i) {
+            verifyChecksum(entries[indices[i]], records[i].id, records[i].data.data());
+        }
+        return records;
+    }
+    
+    std::ifstream in;
+    std::unique_ptr<DirectFile> direct;
+    if (mode == IoMode::Direct) {
+        direct = std::make_unique<DirectFile>(path, DirectFile::Mode::Read);
+    } else if (!blockCache) {
+        // with a cache the file is only opened on the first miss
+        in.open(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open data file for reading");
+    }
     
     std::vector<std::pair<int, size_t>> sorted;
     sorted.reserve(indices.size());
@@ -68,45 +226,541 @@ std::vector<Record> SingleFileStrategy::readRandom(const std::vector<int>& indic
         sorted.emplace_back(indices[i], i);
     }
     std::sort(sorted.begin(), sorted.end(),
-              [this](const auto& a, const auto& b) {
-                  return index[a.first].offset < index[b.first].offset;
+              [&entries](const auto& a, const auto& b) {
+                  return entries[a.first].offset < entries[b.first].offset;
               });
     
     std::vector<Record> records(indices.size());
+    OpLap timer = lap(OpType::RandRead);
+    if (direct) {
+        // whole pages around each record, then copy out the middle
+        auto page = bufferPool.acquire();
+        for (const auto& [idx, origPos] : sorted) {
+            const auto& entry = entries[idx];
+            Record record(entry.recordId, entry.size);
+            const char* src = direct->readRange(*page, entry.offset, entry.size);
+            verifyChecksum(entry, entry.recordId, src);
+            std::memcpy(record.data.data(), src, entry.size);
+            records[origPos] = std::move(record);
+            timer.mark();
+        }
+        return records;
+    }
+    
     for (const auto& [idx, origPos] : sorted) {
-        const auto& entry = index[idx];
+        const auto& entry = entries[idx];
         Record record(entry.recordId, entry.size);
-        in.seekg(entry.offset);
-        in.read(record.data.data(), entry.size);
+        if (blockCache) {
+            cachedRead(path, in, entry.offset, entry.size, record.data.data());
+        } else {
+            in.seekg(entry.offset);
+            if (!in.read(record.data.data(), entry.size))
+                throw std::runtime_error("short read from data file");
+        }
+        verifyChecksum(entry, entry.recordId, record.data.data());
         records[origPos] = std::move(record);
+        timer.mark();
     }
     
     return records;
 }
 
-void SingleFileStrategy::writeIndex() {
-    std::ofstream out(indexFile, std::ios::binary);
-    if (!out) throw std::runtime_error("Failed to open index file for writing");
+void SingleFileStrategy::scanSequential(const RecordVisitor& visit) {
+    auto snap = snapshot();
+    if (mode == IoMode::Mmap) {
+        for (const auto& view : viewSequential(*snap, mapped(*snap))) visit(view);
+        return;
+    }
+    
+    const auto& entries = snap->index;
+    std::ifstream in;
+    std::unique_ptr<DirectFile> direct;
+    std::optional<AlignedBufferPool::Lease> directBuf;
+    std::vector<char> block;
+    if (mode == IoMode::Direct) {
+        direct = std::make_unique<DirectFile>(snap->dataFile, DirectFile::Mode::Read);
+        directBuf.emplace(bufferPool.acquire());
+    } else {
+        in.open(snap->dataFile, std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open data file for reading");
+        block.resize(bufferSize);
+    }
+    
+    // records are laid out back to back, so pull in as many whole records
+    // as fit in the block with one read and hand out views into it. A
+    // record moved by update() (or a removed one) ends the block early.
+    constexpr size_t blockSize = bufferSize;
+    
+    size_t i = 0;
+    while (i < entries.size()) {
+        if (entries[i].recordId == IndexFile::removed) {
+            ++i;
+            continue;
+        }
+        size_t first = i;
+        size_t blockStart = entries[first].offset;
+        size_t bytes = 0;
+        while (i < entries.size() && entries[i].recordId != IndexFile::removed &&
+               (i == first || (entries[i].offset == blockStart + bytes && bytes + entries[i].size <= blockSize))) {
+            bytes += entries[i].size;
+            ++i;
+        }
+        
+        const char* base;
+        if (direct) {
+            base = direct->readRange(**directBuf, blockStart, bytes);
+        } else {
+            if (bytes > block.size()) block.resize(bytes);  // one oversized record
+            in.seekg(blockStart);
+            if (!in.read(block.data(), bytes))
+                throw std::runtime_error("short read from data file");
+            base = block.data();
+        }
+        
+        for (size_t j = first; j < i; ++j) {
+            const auto& entry = entries[j];
+            const char* data = base + (entry.offset - blockStart);
+            verifyChecksum(entry, entry.recordId, data);
+            visit(RecordView(entry.recordId, data, entry.size));
+        }
+    }
+}
+
+void SingleFileStrategy::scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) {
+    auto snap = snapshot();
+    if (mode == IoMode::Mmap) {
+        for (const auto& view : viewRandom(*snap, mapped(*snap), indices)) visit(view);
+        return;
+    }
+    
+    const auto& entries = snap->index;
+    const std::string& path = snap->dataFile;
+    for (int idx : indices) liveEntry(entries, idx);
+    std::vector<int> sorted(indices);
+    std::sort(sorted.begin(), sorted.end(),
+              [&entries](int a, int b) { return entries[a].offset < entries[b].offset; });
+    
+    if (mode == IoMode::Direct) {
+        DirectFile direct(path, DirectFile::Mode::Read);
+        auto page = bufferPool.acquire();
+        for (int idx : sorted) {
+            const auto& entry = entries[idx];
+            const char* data = direct.readRange(*page, entry.offset, entry.size);
+            verifyChecksum(entry, entry.recordId, data);
+            visit(RecordView(entry.recordId, data, entry.size));
+        }
+        return;
+    }
+    
+    if (!blockCache && coalesce) {
+        // a slice of the (offset sorted) batch at a time into one reused buffer
+        constexpr size_t sliceSize = 4096;
+        std::vector<char> batch;
+        std::vector<size_t> at;
+        std::vector<ReadPlanner::Request> requests;
+        for (size_t start = 0; start < sorted.size(); start += sliceSize) {
+            size_t end = std::min(sorted.size(), start + sliceSize);
+            at.clear();
+            size_t total = 0;
+            for (size_t i = start; i < end; ++i) {
+                at.push_back(total);
+                total += entries[sorted[i]].size;
+            }
+            if (batch.size() < total) batch.resize(total);
+            
+            requests.clear();
+            for (size_t i = start; i < end; ++i) {
+                const auto& entry = entries[sorted[i]];
+                requests.push_back({entry.offset, entry.size, batch.data() + at[i - start]});
+            }
+            ReadPlanner::read(fds.acquire(path)->fd(), path, requests, coalesceGap);
+            
+            for (size_t i = start; i < end; ++i) {
+                const auto& entry = entries[sorted[i]];
+                const char* data = batch.data() + at[i - start];
+                verifyChecksum(entry, entry.recordId, data);
+                visit(RecordView(entry.recordId, data, entry.size));
+            }
+        }
+        return;
+    }
+    
+    std::ifstream in;
+    if (!blockCache) {
+        in.open(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Failed to open data file for reading");
+    }
+    
+    std::vector<char> scratch;
+    for (int idx : sorted) {
+        const auto& entry = entries[idx];
+        if (scratch.size() < entry.size) scratch.resize(entry.size);
+        if (blockCache) {
+            cachedRead(path, in, entry.offset, entry.size, scratch.data());
+        } else {
+            in.seekg(entry.offset);
+            if (!in.read(scratch.data(), entry.size))
+                throw std::runtime_error("short read from data file");
+        }
+        verifyChecksum(entry, entry.recordId, scratch.data());
+        visit(RecordView(entry.recordId, scratch.data(), entry.size));
+    }
+}
+
+void SingleFileStrategy::writeDirect(RecordStream& stream, std::vector<IndexEntry>& entries) {
+    DirectFile out(dataFile, DirectFile::Mode::Write);
+    auto lease = bufferPool.acquire(bufferSize);
+    char* buf = lease->data();
     
-    size_t count = index.size();
-    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
-    out.write(reinterpret_cast<const char*>(index.data()), count * sizeof(IndexEntry));
+    paddingBytes = 0;
+    
+    // records are packed into the aligned buffer back to back (no per-record
+    // alignment) and the buffer goes out whenever it fills up
+    size_t fill = 0;
+    size_t fileOffset = 0;
+    size_t currentOffset = 0;
+    OpLap timer = lap(OpType::Write);
+    while (const Record* record = stream.next()) {
+        timer.restart();
+        const char* src = record->data.data();
+        size_t remaining = record->data.size();
+        while (remaining > 0) {
+            size_t n = std::min(remaining, bufferSize - fill);
+            std::memcpy(buf + fill, src, n);
+            fill += n;
+            src += n;
+            remaining -= n;
+            if (fill == bufferSize) {
+                out.writeAt(buf, bufferSize, fileOffset);
+                fileOffset += bufferSize;
+                fill = 0;
+            }
+        }
+        entries.emplace_back(record->id, currentOffset, record->data.size(),
+                             recordChecksum(record->data.data(), record->data.size()));
+        currentOffset += record->data.size();
+        timer.mark();
+    }
+    
+    // the tail has to go out as whole blocks too. Pad it with zeros and cut
+    // the file back afterwards so the layout matches the buffered mode.
+    if (fill > 0) {
+        size_t padded = alignUp(fill);
+        std::memset(buf + fill, 0, padded - fill);
+        out.writeAt(buf, padded, fileOffset);
+        paddingBytes += padded - fill;
+    }
+    out.truncate(currentOffset);
+}
+
+const MappedFile& SingleFileStrategy::mapped(const Snapshot& snap) const {
+    if (mode != IoMode::Mmap)
+        throw std::logic_error("record views need SingleFile in mmap mode");
+    return *snap.file;
+}
+
+std::vector<RecordView> SingleFileStrategy::viewSequential() {
+    auto snap = snapshot();
+    return viewSequential(*snap, mapped(*snap));
+}
+
+std::vector<RecordView> SingleFileStrategy::viewRandom(const std::vector<int>& indices) {
+    auto snap = snapshot();
+    return viewRandom(*snap, mapped(*snap), indices);
+}
+
+std::vector<RecordView> SingleFileStrategy::viewSequential(const Snapshot& snap, const MappedFile& file) {
+    file.advise(MappedFile::Access::Sequential);
+    
+    std::vector<RecordView> views;
+    views.reserve(snap.index.size());
+    
+    for (const auto& entry : snap.index) {
+        if (entry.recordId == IndexFile::removed) continue;
+        if (entry.offset + entry.size > file.size())
+            throw std::runtime_error("index points past end of data file");
+        verifyChecksum(entry, entry.recordId, file.data() + entry.offset);
+        views.emplace_back(entry.recordId, file.data() + entry.offset, entry.size);
+    }
+    
+    return views;
+}
+
+std::vector<RecordView> SingleFileStrategy::viewRandom(const Snapshot& snap, const MappedFile& file,
+                                                       const std::vector<int>& indices) {
+    file.advise(MappedFile::Access::Random);
+    
+    // no seeks here so there's nothing to gain from sorting by offset
+    std::vector<RecordView> views;
+    views.reserve(indices.size());
+    
+    for (int idx : indices) {
+        const auto& entry = liveEntry(snap.index, idx);
+        if (entry.offset + entry.size > file.size())
+            throw std::runtime_error("index points past end of data file");
+        verifyChecksum(entry, entry.recordId, file.data() + entry.offset);
+        views.emplace_back(entry.recordId, file.data() + entry.offset, entry.size);
+    }
+    
+    return views;
+}
+
+Record SingleFileStrategy::readOne(int id) {
+    auto snap = snapshot();
+    const auto& entry = liveEntry(snap->index, id);
+    Record record(entry.recordId, entry.size);
+    
+    if (mode == IoMode::Mmap) {
+        const MappedFile& file = mapped(*snap);
+        if (entry.offset + entry.size > file.size())
+            throw std::runtime_error("index points past end of data file");
+        std::memcpy(record.data.data(), file.data() + entry.offset, entry.size);
+    } else if (mode == IoMode::Direct) {
+        DirectFile in(snap->dataFile, DirectFile::Mode::Read);
+        auto page = bufferPool.acquire();
+        std::memcpy(record.data.data(), in.readRange(*page, entry.offset, entry.size), entry.size);
+    } else if (blockCache) {
+        std::ifstream in;
+        cachedRead(snap->dataFile, in, entry.offset, entry.size, record.data.data());
+    } else {
+        fds.acquire(snap->dataFile)->readAt(record.data.data(), entry.size, entry.offset);
+    }
+    
+    verifyChecksum(entry, entry.recordId, record.data.data());
+    return record;
+}
+
+void SingleFileStrategy::writeIndex(const std::vector<IndexEntry>& entries, uint64_t gen, uint64_t dataGen) {
+    IndexFile::Contents contents;
+    contents.entries = &entries;
+    contents.checksums = indexChecksums;
+    contents.aux = {gen, dataGen};
+    IndexFile::write(indexFile, contents);
 }
 
 void SingleFileStrategy::readIndex() {
-    std::ifstream in(indexFile, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open index file for reading");
+    IndexFile file(indexFile);
+    std::vector<IndexEntry> entries;
+    file.decode(entries);
+    indexChecksums = file.hasChecksums();
+    // older indexes only have the one generation for both
+    generation = file.auxCount() > 0 ? file.aux(0) : 0;
+    dataGeneration = file.auxCount() > 1 ? file.aux(1) : generation;
+    dataFile = dataFileFor(dataGeneration);
     
-    size_t count;
-    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    // no log until the first update
+    std::vector<IndexLog::Redirect> redirects;
+    if (fs::exists(logFile)) redirects = log.open(logFile, generation);
+    for (const auto& r : redirects) {
+        if (static_cast<size_t>(r.id) >= entries.size())
+            entries.resize(r.id + 1, IndexEntry(IndexFile::removed, 0, 0));
+        entries[r.id] = r.entry;
+    }
+    
+    // anything in the data file the index doesn't point at is dead
+    dataEnd = fs::exists(dataFile) ? fs::file_size(dataFile) : 0;
+    size_t live = 0;
+    for (const auto& entry : entries) {
+        if (entry.recordId != IndexFile::removed) live += entry.size;
+    }
+    deadBytes = dataEnd > live ? dataEnd - live : 0;
     
-    index.resize(count);
-    in.read(reinterpret_cast<char*>(index.data()), count * sizeof(IndexEntry));
+    index.assign(entries);
+    mapping.reset();
+    if (!epoch) epoch = std::make_shared<SnapshotEpoch>();
+    publish();
+}
+
+void SingleFileStrategy::loadIndex() {
+    if (indexLoaded.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (indexLoaded.load(std::memory_order_relaxed)) return;
+    readIndex();
+    indexLoaded.store(true, std::memory_order_release);
+}
+
+void SingleFileStrategy::publish() {
+    auto snap = std::make_unique<Snapshot>();
+    snap->index = index.share();
+    snap->dataFile = dataFile;
+    snap->dataEnd = dataEnd;
+    if (mode == IoMode::Mmap) {
+        // the file only grows until a compaction replaces it, so the newest
+        // mapping covers the records of every older snapshot too
+        if (!mapping || mapping->size() < dataEnd)
+            mapping = dataEnd > 0 ? std::make_shared<const MappedFile>(dataFile)
+                                  : std::make_shared<const MappedFile>();
+        snap->file = mapping;
+    }
+    snap->epoch = epoch;
+    current.publish(std::move(snap));
+}
+
+SnapshotCell<SingleFileStrategy::Snapshot>::Reader SingleFileStrategy::snapshot() {
+    loadIndex();
+    return current.read();
+}
+
+void SingleFileStrategy::update(int id, const std::vector<char>& data) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    liveEntry(index, id);
+    size_t offset = appendData(data.data(), data.size());
+    commit({{id, IndexEntry(id, offset, data.size(), recordChecksum(data.data(), data.size()))}});
+}
+
+void SingleFileStrategy::remove(int id) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    const auto& old = liveEntry(index, id);
+    commit({{id, IndexEntry(IndexFile::removed, old.offset, 0)}});
+}
+
+void SingleFileStrategy::append(const std::vector<Record>& records) {
+    // nothing to append to yet
+    if (!indexLoaded && !fs::exists(indexFile)) write({});
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    
+    std::vector<IndexLog::Redirect> batch;
+    batch.reserve(records.size());
+    for (const auto& record : records) {
+        if (record.id < 0) throw std::invalid_argument("negative record id " + std::to_string(record.id));
+    }
+    for (const auto& record : records) {
+        size_t offset = appendData(record.data.data(), record.data.size());
+        batch.push_back({record.id, IndexEntry(record.id, offset, record.data.size(),
+                                               recordChecksum(record.data.data(), record.data.size()))});
+    }
+    commit(batch);
+}
+
+size_t SingleFileStrategy::appendData(const char* data, size_t size) {
+    if (!appendOut.is_open()) {
+        appendOut.open(dataFile, std::ios::binary | std::ios::app);
+        if (!appendOut) throw std::runtime_error("Failed to open data file for appending");
+    }
+    appendOut.write(data, size);
+    if (!appendOut) throw std::runtime_error("Failed to append to data file");
+    size_t offset = dataEnd;
+    dataEnd += size;
+    return offset;
+}
+
+void SingleFileStrategy::commit(const std::vector<IndexLog::Redirect>& batch) {
+    // the log is the commit point, so the data has to be out first
+    if (appendOut.is_open() && !appendOut.flush())
+        throw std::runtime_error("Failed to append to data file");
+    if (!log.isOpen()) log.open(logFile, generation);
+    log.append(batch);
+    
+    size_t freed = 0;
+    for (const auto& r : batch) {
+        index.resize(r.id + 1, IndexEntry(IndexFile::removed, 0, 0));
+        if (index[r.id].recordId != IndexFile::removed) freed += index[r.id].size;
+        index.set(r.id, r.entry);
+    }
+    // the block cache notices the file grew by itself, publish() remaps
+    publish();
+    deadBytes += freed;
+    foldLog();
+    
+    if (autoCompactRatio > 0 && deadBytes > autoCompactRatio * dataEnd) compactInBackground();
+}
+
+void SingleFileStrategy::foldLog() {
+    // by now replaying the log on load costs more than reading the index,
+    // and rewriting the index is paid for by as many appends as it has entries
+    if (log.size() < std::max(index.size(), minFoldEntries)) return;
+    writeIndex(index.toVector(), generation + 1, dataGeneration);
+    log.open(logFile, generation + 1);
+    ++generation;
+}
+
+size_t SingleFileStrategy::compact(double garbageRatio) {
+    loadIndex();
+    std::lock_guard<std::mutex> writing(writeMutex);
+    if (dataEnd == 0 || deadBytes <= garbageRatio * dataEnd) return 0;
+    
+    // live records in file order, copied over in runs of neighbours.
+    // Readers carry on with the current snapshot meanwhile.
+    std::vector<IndexEntry> compacted = index.toVector();
+    std::vector<int> ids;
+    ids.reserve(compacted.size());
+    for (size_t i = 0; i < compacted.size(); ++i) {
+        if (compacted[i].recordId != IndexFile::removed) ids.push_back(static_cast<int>(i));
+    }
+    std::sort(ids.begin(), ids.end(),
+              [&compacted](int a, int b) { return compacted[a].offset < compacted[b].offset; });
+    
+    uint64_t nextGen = generation + 1;
+    std::string newFile = dataFileFor(nextGen);
+    size_t written = 0;
+    {
+        std::ofstream out(newFile, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Failed to open data file for writing: " + newFile);
+        auto in = fds.acquire(dataFile);
+        std::vector<char> block;
+        
+        size_t i = 0;
+        while (i < ids.size()) {
+            size_t first = i;
+            size_t start = index[ids[first]].offset;
+            size_t bytes = 0;
+            while (i < ids.size() && (i == first || (index[ids[i]].offset == start + bytes &&
+                                                     bytes + index[ids[i]].size <= bufferSize))) {
+                bytes += index[ids[i]].size;
+                ++i;
+            }
+            if (block.size() < bytes) block.resize(bytes);
+            in->readAt(block.data(), bytes, start);
+            for (size_t j = first; j < i; ++j) {
+                const auto& entry = index[ids[j]];
+                verifyChecksum(entry, ids[j], block.data() + (entry.offset - start));
+                compacted[ids[j]].offset = written + (entry.offset - start);
+            }
+            out.write(block.data(), bytes);
+            written += bytes;
+        }
+        out.close();
+        if (!out) throw std::runtime_error("Failed to write data file: " + newFile);
+    }
+    
+    // publishing the index is the switch-over; the old log is stale after it
+    writeIndex(compacted, nextGen, nextGen);
+    log.open(logFile, nextGen);
+    
+    std::string oldFile = dataFile;
+    size_t reclaimed = dataEnd - written;
+    index.assign(compacted);
+    generation = nextGen;
+    dataGeneration = nextGen;
+    dataFile = newFile;
+    dataEnd = written;
+    deadBytes = 0;
+    appendOut.close();
+    mapping.reset();
+    auto oldEpoch = epoch;
+    epoch = SnapshotEpoch::advance(oldEpoch);
+    publish();
+    
+    // readers still on older snapshots keep the old file until they're done
+    oldEpoch->retire(oldFile);
+    forgetCached(oldFile);
+    fds.forget(oldFile);
+    ++compactions;
+    return reclaimed;
 }
 
 void SingleFileStrategy::cleanUp() {
+    resetGeneration();
+    forgetCached(dataFile);
+    fds.clear();
+    index.clear();
+    indexLoaded = false;
     fs::remove(dataFile);
     fs::remove(indexFile);
+    dataEnd = 0;
 }
 
 size_t SingleFileStrategy::getDiskSpaceUsed() const {
@@ -118,6 +772,13 @@ size_t SingleFileStrategy::getDiskSpaceUsed() const {
     if (fs::exists(indexFile)) {
         total += fs::file_size(indexFile);
     }
+    if (fs::exists(logFile)) {
+        total += fs::file_size(logFile);
+    }
     
     return total;
 }
+
+size_t SingleFileStrategy::getNumFiles() const {
+    return fs::exists(logFile) ? 3 : 2;
+}
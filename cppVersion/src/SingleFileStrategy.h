@@ -1,27 +1,130 @@
 #pragma once
 #include "StorageStrategy.h"
+#include "MappedFile.h"
+#include "AlignedBuffer.h"
+#include "FdCache.h"
+#include "IndexFile.h"
+#include "Snapshot.h"
 #include <vector>
 #include <string>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
-// All records go into one binary file + a separate index file.
+// All records go into one binary file + a separate index file. The index
+// is read on first use and kept in memory until the next write.
+//
+// update()/remove()/append() append to the data file and log the new index
+// entries to an IndexLog next to the index, which gets folded back into the
+// index once it's as long as the index. compact() copies the live records
+// into a new data file and publishes an index that points at it. Index aux
+// is [generation, data file generation]: the first goes up with every
+// index written and ties the log to it, the second names the data file.
+//
+// Reads don't lock: they run against an immutable Snapshot of the index
+// (and in Mmap mode the mapping), published through a SnapshotCell. A
+// reader keeps the snapshot it started with for the whole call; the writer
+// (one at a time) frees old ones once no reader can see them, and with them
+// data files a compaction replaced. write() and cleanUp() wait for readers,
+// so don't call them from a scan's visitor.
 class SingleFileStrategy : public StorageStrategy {
 public:
-    SingleFileStrategy(const std::string& dir);
+    SingleFileStrategy(const std::string& dir, IoMode mode = IoMode::Buffered);
+    ~SingleFileStrategy() override;
     
     void write(const std::vector<Record>& records) override;
+    void writeStream(RecordStream& stream) override;
+    bool supportsStreaming() const override { return true; }
+    bool storesChecksums() const override { return true; }
     std::vector<Record> readSequential() override;
     std::vector<Record> readRandom(const std::vector<int>& indices) override;
+    void scanSequential(const RecordVisitor& visit) override;
+    void scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) override;
+    Record readOne(int id) override;
+    void update(int id, const std::vector<char>& data) override;
+    void remove(int id) override;
+    void append(const std::vector<Record>& records) override;
+    bool supportsUpdates() const override { return true; }
+    size_t getDeadBytes() const override { return deadBytes; }
+    size_t compact(double garbageRatio) override;
+    bool supportsCompaction() const override { return true; }
     void cleanUp() override;
-    std::string getName() const override { return "SingleFile"; }
+    std::string getName() const override {
+        if (mode == IoMode::Mmap)   return "SingleFile(mmap)";
+        if (mode == IoMode::Direct) return "SingleFile(direct)";
+        return "SingleFile";
+    }
+    
+    // Zero-copy reads, only in Mmap mode. The views point into the mapping
+    // and stay valid until the next write(), update(), remove(), append(),
+    // compact() or cleanUp() - the mapping goes with the snapshot.
+    std::vector<RecordView> viewSequential();
+    std::vector<RecordView> viewRandom(const std::vector<int>& indices);
     
     size_t getDiskSpaceUsed() const override;
-    size_t getNumFiles() const override { return 2; }
+    size_t getNumFiles() const override;
+    size_t getPaddingBytes() const override { return paddingBytes; }
     
 private:
-    std::string dataFile;
+    // what a reader sees, never changed once published
+    struct Snapshot {
+        CowVector<IndexEntry> index;
+        std::string dataFile;
+        size_t dataEnd = 0;
+        std::shared_ptr<const MappedFile> file;  // Mmap mode only, covers dataEnd
+        std::shared_ptr<SnapshotEpoch> epoch;
+    };
+    
     std::string indexFile;
-    std::vector<IndexEntry> index;
+    std::string logFile;
+    IoMode mode;
+    AlignedBufferPool bufferPool;  // only used in Direct mode
+    size_t paddingBytes = 0;
+    FdCache fds{1};
+    
+    SnapshotCell<Snapshot> current;
+    std::mutex indexMutex;
+    std::atomic<bool> indexLoaded{false};
+    
+    // The writer's side, under writeMutex: the index the next snapshot is
+    // made from and everything else it needs.
+    std::mutex writeMutex;
+    CowVector<IndexEntry> index;
+    std::string dataFile;
+    IndexLog log;
+    std::ofstream appendOut;
+    uint64_t generation = 0;
+    uint64_t dataGeneration = 0;
+    size_t dataEnd = 0;
+    std::atomic<size_t> deadBytes{0};
+    std::shared_ptr<const MappedFile> mapping;  // of dataFile, redone when it outgrows it
+    std::shared_ptr<SnapshotEpoch> epoch;
     
-    void writeIndex();
+    std::string dataFileFor(uint64_t gen) const;
+    void writeDirect(RecordStream& stream, std::vector<IndexEntry>& entries);
+    // a fresh write() starts over at generation 0 without a log
+    void resetGeneration();
+    // bytes go on the end of the data file, returns where they start
+    size_t appendData(const char* data, size_t size);
+    // logs and applies new entries in one go; whatever they replace is dead
+    void commit(const std::vector<IndexLog::Redirect>& batch);
+    // writes the index with the log folded in, when the log is long enough
+    void foldLog();
+    void writeIndex(const std::vector<IndexEntry>& entries, uint64_t gen, uint64_t dataGen);
     void readIndex();
+    // readIndex() unless the index is already in memory
+    void loadIndex();
+    // the writer's state as the new snapshot; in Mmap mode maps the data
+    // file again first if it grew past the mapping
+    void publish();
+    // loads the index if needed and returns the current snapshot, readable
+    // for as long as the Reader lives
+    SnapshotCell<Snapshot>::Reader snapshot();
+    // snap's mapping of the data file, std::logic_error outside Mmap mode
+    const MappedFile& mapped(const Snapshot& snap) const;
+    std::vector<RecordView> viewSequential(const Snapshot& snap, const MappedFile& file);
+    std::vector<RecordView> viewRandom(const Snapshot& snap, const MappedFile& file,
+                                       const std::vector<int>& indices);
 };
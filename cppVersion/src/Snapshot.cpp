@@ -0,0 +1,48 @@
+#include "Snapshot.h"
+#include <filesystem>
+
+SnapshotEpoch::~SnapshotEpoch() {
+    // no one can throw from here, a file that's already gone is fine
+    std::error_code ec;
+    for (const auto& path : retired) std::filesystem::remove(path, ec);
+}
+
+std::shared_ptr<SnapshotEpoch> SnapshotEpoch::advance(const std::shared_ptr<SnapshotEpoch>& current) {
+    auto next = std::make_shared<SnapshotEpoch>();
+    if (current) {
+        std::lock_guard<std::mutex> lock(current->mtx);
+        current->next = next;
+    }
+    return next;
+}
+
+void SnapshotEpoch::retire(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    retired.push_back(path);
+}
+
+size_t GracePeriod::enter() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % numSlots;
+    size_t p = phase.load(std::memory_order_seq_cst) & 1;
+    slots[slot].count[p].fetch_add(1, std::memory_order_seq_cst);
+    return slot * 2 + p;
+}
+
+void GracePeriod::leave(size_t token) {
+    slots[token / 2].count[token % 2].fetch_sub(1, std::memory_order_release);
+}
+
+bool GracePeriod::tryDrain() {
+    // A reader that read the phase just before a flip can still turn up in
+    // the draining half after this looked. Its pointer load comes later, so
+    // it only sees what's swapped out after now - and the two drains after
+    // that swap look at both halves.
+    size_t draining = (phase.load(std::memory_order_relaxed) & 1) ^ 1;
+    for (const auto& slot : slots) {
+        if (slot.count[draining].load(std::memory_order_seq_cst) != 0) return false;
+    }
+    phase.store(draining, std::memory_order_seq_cst);
+    ++drained;
+    return true;
+}
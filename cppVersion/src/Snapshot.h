@@ -0,0 +1,251 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <utility>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <cstddef>
+
+// Vector split into fixed-size pages that copies share, so an index can be
+// handed to readers as an immutable snapshot without copying it: publishing
+// costs one pointer per page, and the writer copies a page the first time it
+// changes it after that. Not thread safe itself - one writer changes it,
+// readers only ever see the copies.
+template <class T>
+class CowVector {
+public:
+    static constexpr size_t pageBits = 10;
+    static constexpr size_t pageSize = size_t(1) << pageBits;
+    
+    class const_iterator {
+    public:
+        const_iterator(const CowVector* v, size_t i) : v(v), i(i) {}
+        const T& operator*() const { return (*v)[i]; }
+        const_iterator& operator++() { ++i; return *this; }
+        bool operator!=(const const_iterator& o) const { return i != o.i; }
+    private:
+        const CowVector* v;
+        size_t i;
+    };
+    
+    CowVector() = default;
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return (*pages[i >> pageBits])[i & (pageSize - 1)]; }
+    const T& back() const { return (*this)[count - 1]; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, count}; }
+    
+    void set(size_t i, const T& value) { writable(i >> pageBits)[i & (pageSize - 1)] = value; }
+    
+    void push_back(const T& value) {
+        if ((count & (pageSize - 1)) == 0) {
+            pages.push_back(std::make_shared<Page>());
+            pages.back()->reserve(pageSize);
+            owned.push_back(true);
+        }
+        writable(pages.size() - 1).push_back(value);
+        ++count;
+    }
+    
+    // only grows
+    void resize(size_t n, const T& fill) {
+        while (count < n) push_back(fill);
+    }
+    
+    void assign(const std::vector<T>& values) {
+        clear();
+        for (size_t first = 0; first < values.size(); first += pageSize) {
+            size_t last = std::min(values.size(), first + pageSize);
+            pages.push_back(std::make_shared<Page>(values.begin() + first, values.begin() + last));
+            owned.push_back(true);
+        }
+        count = values.size();
+    }
+    
+    void clear() {
+        pages.clear();
+        owned.clear();
+        count = 0;
+    }
+    
+    std::vector<T> toVector() const {
+        std::vector<T> out;
+        out.reserve(count);
+        for (const auto& page : pages) out.insert(out.end(), page->begin(), page->end());
+        return out;
+    }
+    
+    // A copy for readers. It shares every page with this one, which copies
+    // a page before it next changes it.
+    CowVector share() {
+        owned.assign(owned.size(), false);
+        return *this;
+    }
+    
+private:
+    using Page = std::vector<T>;
+    
+    std::vector<std::shared_ptr<Page>> pages;
+    std::vector<bool> owned;  // pages no copy has seen, safe to change in place
+    size_t count = 0;
+    
+    Page& writable(size_t page) {
+        if (!owned[page]) {
+            auto copy = std::make_shared<Page>();
+            copy->reserve(pageSize);
+            copy->assign(pages[page]->begin(), pages[page]->end());
+            pages[page] = std::move(copy);
+            owned[page] = true;
+        }
+        return *pages[page];
+    }
+};
+
+// When files that old snapshots may still read can go. Every snapshot holds
+// the epoch it was published in; a writer that stops using some files (a
+// compaction) starts a new epoch and retires them into the old one. An
+// epoch deletes its retired files when it goes away, and holds on to the
+// epoch after it, so that only happens once no snapshot from that epoch or
+// any earlier one is left.
+class SnapshotEpoch {
+public:
+    SnapshotEpoch() = default;
+    ~SnapshotEpoch();
+    
+    SnapshotEpoch(const SnapshotEpoch&) = delete;
+    SnapshotEpoch& operator=(const SnapshotEpoch&) = delete;
+    
+    // the epoch after `current`, which lives at least as long as it does
+    static std::shared_ptr<SnapshotEpoch> advance(const std::shared_ptr<SnapshotEpoch>& current);
+    
+    void retire(const std::string& path);
+    
+private:
+    std::mutex mtx;
+    std::vector<std::string> retired;
+    std::shared_ptr<SnapshotEpoch> next;
+};
+
+// Read side of an RCU scheme. A reader enter()s a section, which is one
+// counter increment in a slot picked per thread (so readers on different
+// cores don't share a cache line), and leave()s it when done with whatever
+// it loaded in there. Readers never wait.
+//
+// The writer side works in halves: new sections count in one, the other
+// only drains. tryDrain() checks whether the draining half is empty and if
+// so flips them, without ever waiting. Something the writer swapped out is
+// safe to free after two drains that both came after the swap - one for
+// each half, and any reader that could still see it counted in one of them.
+class GracePeriod {
+public:
+    // what leave() needs, the slot and the half the section counted in
+    size_t enter();
+    void leave(size_t token);
+    
+    // writer side, one writer at a time
+    bool tryDrain();
+    uint64_t drains() const { return drained; }
+    
+private:
+    static constexpr size_t numSlots = 64;
+    struct alignas(64) Slot {
+        std::atomic<size_t> count[2] = {};
+    };
+    
+    Slot slots[numSlots];
+    std::atomic<size_t> phase{0};  // the half new sections count in
+    uint64_t drained = 0;
+};
+
+// The newest T, handed to readers as a plain pointer. read() opens a
+// section for as long as the returned Reader lives. publish() swaps in the
+// next T and frees older ones once no section can see them any more, never
+// waiting for readers: what's still in use is kept for a later publish().
+// Writers take turns on a mutex readers never touch.
+template <class T>
+class SnapshotCell {
+public:
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept : grace(other.grace), token(other.token), value(other.value) {
+            other.grace = nullptr;
+        }
+        Reader& operator=(Reader&&) = delete;
+        ~Reader() {
+            if (grace) grace->leave(token);
+        }
+        
+        const T* get() const { return value; }
+        const T& operator*() const { return *value; }
+        const T* operator->() const { return value; }
+        explicit operator bool() const { return value != nullptr; }
+        
+    private:
+        friend class SnapshotCell;
+        Reader(GracePeriod* grace, size_t token, const T* value) : grace(grace), token(token), value(value) {}
+        
+        GracePeriod* grace;
+        size_t token;
+        const T* value;
+    };
+    
+    SnapshotCell() = default;
+    ~SnapshotCell() {
+        // no readers left by now
+        delete current.load();
+        for (const auto& old : retired) delete old.second;
+    }
+    
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+    
+    Reader read() {
+        size_t token = grace.enter();
+        // seq_cst like the count: either the writer's drain sees this reader,
+        // or this load sees what the writer swapped in
+        return Reader(&grace, token, current.load(std::memory_order_seq_cst));
+    }
+    
+    void publish(std::unique_ptr<const T> next) {
+        std::lock_guard<std::mutex> lock(writing);
+        const T* old = current.exchange(next.release(), std::memory_order_seq_cst);
+        if (old) retired.emplace_back(grace.drains(), old);
+        reclaim(false);
+    }
+    
+    // Publishes nothing and waits until every old T is freed. For write()
+    // and cleanUp(), which need the files behind them gone and have no
+    // readers to wait for anyway.
+    void reset() {
+        std::lock_guard<std::mutex> lock(writing);
+        const T* old = current.exchange(nullptr, std::memory_order_seq_cst);
+        if (old) retired.emplace_back(grace.drains(), old);
+        reclaim(true);
+    }
+    
+private:
+    std::atomic<const T*> current{nullptr};
+    GracePeriod grace;
+    std::mutex writing;
+    std::deque<std::pair<uint64_t, const T*>> retired;  // oldest first, with drains() when swapped out
+    
+    void reclaim(bool wait) {
+        while (!retired.empty()) {
+            if (grace.drains() >= retired.front().first + 2) {
+                delete retired.front().second;
+                retired.pop_front();
+                continue;
+            }
+            if (grace.tryDrain()) continue;
+            if (!wait) return;
+            std::this_thread::yield();
+        }
+    }
+};
@@ -0,0 +1,38 @@
+#include "Statistics.h"
+#include <cmath>
+
+namespace {
+// two-sided 95% t critical values for 1..30 degrees of freedom
+const double tTable[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+double tCritical(size_t dof) {
+    if (dof == 0) return 0.0;
+    if (dof <= 30) return tTable[dof - 1];
+    return 1.96;
+}
+}
+
+SampleStats SampleStats::of(const std::vector<double>& samples) {
+    SampleStats s;
+    s.n = samples.size();
+    if (s.n == 0) return s;
+    
+    double sum = 0.0;
+    for (double v : samples) sum += v;
+    s.mean = sum / s.n;
+    
+    if (s.n > 1) {
+        double sq = 0.0;
+        for (double v : samples) sq += (v - s.mean) * (v - s.mean);
+        s.stddev = std::sqrt(sq / (s.n - 1));
+    }
+    
+    double half = tCritical(s.n - 1) * s.stddev / std::sqrt(static_cast<double>(s.n));
+    s.ciLow = s.mean - half;
+    s.ciHigh = s.mean + half;
+    return s;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// mean/stddev and a 95% confidence interval for the mean (Student's t, so
+// it's honest for the handful of repetitions we usually do)
+struct SampleStats {
+    size_t n = 0;
+    double mean = 0.0;
+    double stddev = 0.0;   // sample stddev, 0 for a single run
+    double ciLow = 0.0;
+    double ciHigh = 0.0;
+    
+    static SampleStats of(const std::vector<double>& samples);
+};
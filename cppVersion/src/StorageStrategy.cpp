@@ -1 +1,139 @@
 #include "StorageStrategy.h"
+#include "BlockCache.h"
+#include "Checksum.h"
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+void StorageStrategy::writeStream(RecordStream& stream) {
+    std::vector<Record> records;
+    records.reserve(stream.size());
+    while (const Record* record = stream.next()) records.push_back(*record);
+    write(records);
+}
+
+void StorageStrategy::scanSequential(const RecordVisitor& visit) {
+    for (const auto& record : readSequential()) {
+        visit(RecordView(record.id, record.data.data(), record.data.size()));
+    }
+}
+
+void StorageStrategy::scanRandom(const std::vector<int>& indices, const RecordVisitor& visit) {
+    for (const auto& record : readRandom(indices)) {
+        visit(RecordView(record.id, record.data.data(), record.data.size()));
+    }
+}
+
+Record StorageStrategy::readOne(int id) {
+    return std::move(readRandom({id}).front());
+}
+
+void StorageStrategy::update(int, const std::vector<char>&) {
+    throw std::logic_error(getName() + " doesn't support updates");
+}
+
+void StorageStrategy::remove(int) {
+    throw std::logic_error(getName() + " doesn't support removing records");
+}
+
+void StorageStrategy::append(const std::vector<Record>&) {
+    throw std::logic_error(getName() + " doesn't support appending");
+}
+
+size_t StorageStrategy::compact(double) {
+    return 0;
+}
+
+namespace {
+thread_local bool compactorThread = false;
+}
+
+bool StorageStrategy::onCompactorThread() {
+    return compactorThread;
+}
+
+void StorageStrategy::compactInBackground() {
+    std::lock_guard<std::mutex> lock(compactorMutex);
+    if (compactorBusy) return;
+    if (compactor.joinable()) compactor.join();
+    compactorBusy = true;
+    compactor = std::thread([this] {
+        compactorThread = true;
+        try {
+            compact(autoCompactRatio);
+        } catch (...) {
+            compactorError = std::current_exception();
+        }
+        compactorBusy = false;
+    });
+}
+
+void StorageStrategy::waitForCompaction() {
+    std::lock_guard<std::mutex> lock(compactorMutex);
+    if (compactor.joinable()) compactor.join();
+    if (compactorError) {
+        auto error = compactorError;
+        compactorError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void StorageStrategy::readSequentialBatch(RecordBatch& batch) {
+    batch.clear();
+    scanSequential([&](const RecordView& view) { batch.append(view); });
+}
+
+void StorageStrategy::readRandomBatch(const std::vector<int>& indices, RecordBatch& batch) {
+    batch.clear();
+    batch.reserve(indices.size(), 0);
+    scanRandom(indices, [&](const RecordView& view) { batch.append(view); });
+    
+    // scanRandom picks its own order, put the views back in request order
+    std::vector<size_t> byId(batch.size());
+    for (size_t i = 0; i < byId.size(); ++i) byId[i] = i;
+    std::sort(byId.begin(), byId.end(), [&](size_t a, size_t b) { return batch[a].id < batch[b].id; });
+    std::vector<size_t> order;
+    order.reserve(indices.size());
+    for (int id : indices) {
+        auto it = std::lower_bound(byId.begin(), byId.end(), id,
+                                   [&](size_t i, int want) { return batch[i].id < want; });
+        if (it == byId.end() || batch[*it].id != id)
+            throw std::runtime_error("scan skipped record " + std::to_string(id));
+        order.push_back(*it);
+    }
+    batch.reorder(order);
+}
+
+void StorageStrategy::cachedRead(const std::string& path, std::ifstream& in,
+                                 size_t offset, size_t len, char* dest) {
+    blockCache->read(blockCache->fileId(path), offset, len, dest,
+                     [&](size_t blockOffset, char* buf, size_t blockSize) {
+                         if (!in.is_open()) {
+                             in.open(path, std::ios::binary);
+                             if (!in) throw std::runtime_error("Failed to open " + path);
+                         }
+                         in.seekg(blockOffset);
+                         in.read(buf, blockSize);
+                         size_t got = static_cast<size_t>(in.gcount());
+                         in.clear();  // a short last block sets eof/fail
+                         return got;
+                     });
+}
+
+void StorageStrategy::forgetCached(const std::string& path) {
+    if (blockCache) blockCache->forget(path);
+}
+
+uint32_t StorageStrategy::recordChecksum(const char* data, size_t size) const {
+    return indexChecksums ? crc32c(data, size) : 0;
+}
+
+void StorageStrategy::verifyChecksum(const IndexEntry& entry, int recordId, const char* data) const {
+    if (indexChecksums && crc32c(data, entry.size) != entry.checksum)
+        throw std::runtime_error("checksum mismatch for record " + std::to_string(recordId) + " in " + baseDir);
+}
+
+void StorageStrategy::noRecord(int id) const {
+    throw std::out_of_range("no record " + std::to_string(id) + " in " + baseDir);
+}
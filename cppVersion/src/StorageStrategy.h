@@ -1,22 +1,202 @@
 #pragma once
 #include "Record.h"
+#include "RecordStream.h"
+#include "RecordBatch.h"
+#include "LatencyHistogram.h"
+#include "ReadPlanner.h"
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <iosfwd>
+
+class BlockCache;
+
+// how a strategy talks to its files. Not every strategy supports every mode.
+enum class IoMode {
+    Buffered,   // std::fstream through the page cache
+    Mmap,       // map the data file and read straight out of the mapping
+    Direct      // O_DIRECT with aligned buffers, bypasses the page cache
+};
+
+// what it cost to make the last write() durable, for strategies that sync
+struct DurabilityStats {
+    size_t syncs = 0;
+    double avgCommitLatency = 0.0;   // seconds from append to durable, per record
+    double maxCommitLatency = 0.0;
+};
+
+// open() calls made vs. avoided by strategies that keep descriptors around
+struct FileHandleStats {
+    size_t opens = 0;
+    size_t reuses = 0;
+    size_t evictions = 0;
+};
+
+// called once per record by the scan API. The view is only valid for the
+// duration of the call - copy the bytes out if you need to keep them.
+using RecordVisitor = std::function<void(const RecordView&)>;
 
 class StorageStrategy {
 public:
     virtual ~StorageStrategy() = default;
     
     virtual void write(const std::vector<Record>& records) = 0;
+    
+    // Same as write() but pulls the records one at a time, for datasets
+    // that don't fit in memory. Strategies that can write with bounded
+    // memory override it and say so in supportsStreaming(); the default
+    // collects the whole stream and calls write().
+    virtual void writeStream(RecordStream& stream);
+    virtual bool supportsStreaming() const { return false; }
+    
     virtual std::vector<Record> readSequential() = 0;
     virtual std::vector<Record> readRandom(const std::vector<int>& indices) = 0;
+    
+    // Non-owning alternative to the read API for callers that look at each
+    // record once and throw it away. Records are handed out of a reused
+    // buffer (or a mapping) instead of one heap allocation per record.
+    // scanRandom may visit in whatever order is cheapest; use view.id.
+    // The defaults just go through readSequential/readRandom.
+    virtual void scanSequential(const RecordVisitor& visit);
+    virtual void scanRandom(const std::vector<int>& indices, const RecordVisitor& visit);
+    
+    // One record, numbered like readRandom's indices. For serving-style
+    // point lookups: strategies that can keep their index and files open
+    // between calls override it, the default is just readRandom({id}).
+    virtual Record readOne(int id);
+    
+    // readSequential/readRandom into one arena instead of a heap allocation
+    // per record. out is cleared first, so a batch reused across calls
+    // doesn't allocate at all once it's big enough. The defaults copy out
+    // of scanSequential/scanRandom.
+    virtual void readSequentialBatch(RecordBatch& out);
+    virtual void readRandomBatch(const std::vector<int>& indices, RecordBatch& out);
+    
+    // Changing single records after write(), for strategies with an index
+    // to redirect (SingleFile, Chunked, Packed). The new bytes are appended
+    // and the record's index entry pointed at them; the old bytes stay
+    // behind as dead bytes until compact() gets rid of them. A removed id
+    // reads like one that never existed. Both throw std::out_of_range for
+    // ids that aren't there and std::logic_error where it isn't supported
+    // (the default); supportsUpdates() says which it is.
+    virtual void update(int id, const std::vector<char>& data);
+    virtual void remove(int id);
+    
+    // Adds records behind what's stored without rewriting it: O(batch), not
+    // O(everything) like write(). Ids past the end grow the store, ids
+    // already there are replaced like update(). On SingleFile and Chunked
+    // the whole batch becomes visible to readers (and survives a crash) at
+    // once or not at all. Appending to an empty directory starts a new
+    // store. std::logic_error where it isn't supported (the default).
+    virtual void append(const std::vector<Record>& records);
+    virtual bool supportsUpdates() const { return false; }
+    virtual size_t getDeadBytes() const { return 0; }
+    
+    // Rewrites the files (SingleFile) or chunks (Chunked) where more than
+    // garbageRatio of the bytes are dead and returns the bytes reclaimed.
+    // Readers carry on meanwhile, and never wait for it on SingleFile and
+    // Chunked. The default does nothing, supportsCompaction() says which.
+    virtual size_t compact(double garbageRatio);
+    virtual bool supportsCompaction() const { return false; }
+    
+    // Starts compact(garbageRatio) on a background thread whenever an update
+    // or remove pushes the garbage past it. 0 (the default) turns it off.
+    // waitForCompaction() joins a running one and rethrows what it threw.
+    void setAutoCompaction(double garbageRatio) { autoCompactRatio = garbageRatio; }
+    void waitForCompaction();
+    size_t getCompactions() const { return compactions; }
+    
     virtual void cleanUp() = 0;
     virtual std::string getName() const = 0;
     
     virtual size_t getDiskSpaceUsed() const = 0;
     virtual size_t getNumFiles() const = 0;
+    // zero bytes written only to satisfy I/O alignment (Direct mode)
+    virtual size_t getPaddingBytes() const { return 0; }
+    virtual DurabilityStats getDurabilityStats() const { return {}; }
+    virtual FileHandleStats getFileHandleStats() const { return {}; }
+    
+    // Opt into a block cache for random reads (scans included). The same
+    // cache can be handed to several strategies. Only buffered reads go
+    // through it; mmap, O_DIRECT and async paths ignore it.
+    void setBlockCache(std::shared_ptr<BlockCache> cache) { blockCache = std::move(cache); }
+    BlockCache* getBlockCache() const { return blockCache.get(); }
+    
+    // Random reads merge requests at most maxGap bytes apart into one
+    // preadv (see ReadPlanner). On by default; only SingleFile and Chunked
+    // use it, and only for buffered reads without a block cache.
+    void setReadCoalescing(bool enabled, size_t maxGap = ReadPlanner::defaultMaxGap) {
+        coalesce = enabled;
+        coalesceGap = maxGap;
+    }
+    
+    // Per-record crc32c kept in the index and checked on every read, on by
+    // default. Only SingleFile and Chunked have one; turning it off is
+    // there to measure what it costs. Applies from the next write(); until
+    // then updates, appends and compaction keep to what the index has.
+    void setChecksums(bool enabled) { checksums = enabled; }
+    bool checksumsEnabled() const { return checksums; }
+    virtual bool storesChecksums() const { return false; }
+    
+    // Per-record latency histograms for write/readSequential/readRandom.
+    // Null (the default) turns the timing off. Not owned.
+    void setLatencyRecorder(OpLatencies* recorder) { latencies = recorder; }
     
 protected:
     std::string baseDir;
+    std::shared_ptr<BlockCache> blockCache;
+    OpLatencies* latencies = nullptr;
+    bool checksums = true;
+    // whether the index in use has checksums: `checksums` as of the write()
+    // that made it, or the flag in the file it was loaded from
+    std::atomic<bool> indexChecksums{true};
+    bool coalesce = true;
+    size_t coalesceGap = ReadPlanner::defaultMaxGap;
+    double autoCompactRatio = 0.0;
+    std::atomic<size_t> compactions{0};
+    
+    // call mark() on it once per record, see OpLap
+    OpLap lap(OpType op) const { return OpLap(latencies ? &latencies->get(op) : nullptr); }
+    
+    // [offset, offset + len) of path via blockCache. `in` is only opened
+    // (and kept open for the next call) when a block has to be loaded.
+    void cachedRead(const std::string& path, std::ifstream& in,
+                    size_t offset, size_t len, char* dest);
+    void forgetCached(const std::string& path);
+    
+    // what goes in IndexEntry::checksum, and the check on the way back.
+    // verifyChecksum throws std::runtime_error on a mismatch.
+    uint32_t recordChecksum(const char* data, size_t size) const;
+    void verifyChecksum(const IndexEntry& entry, int recordId, const char* data) const;
+    
+    // index[id] if the record exists, std::out_of_range if it never did or
+    // was removed (entry.recordId == -1). Any index with size() and [].
+    template <class Index>
+    const IndexEntry& liveEntry(const Index& index, int id) const {
+        if (id < 0 || static_cast<size_t>(id) >= index.size() || index[id].recordId == -1) noRecord(id);
+        return index[id];
+    }
+    [[noreturn]] void noRecord(int id) const;
+    
+    // compact(autoCompactRatio) on the background thread, unless one is
+    // running already. Derived destructors have to waitForCompaction()
+    // before their members go away.
+    void compactInBackground();
+    
+    // true on the thread compactInBackground() started. Strategies with a
+    // worker pool run the compactor's work serially instead, so it never
+    // queues behind (or holds up) foreground reads in that pool.
+    static bool onCompactorThread();
+    
+private:
+    std::mutex compactorMutex;
+    std::thread compactor;
+    std::atomic<bool> compactorBusy{false};
+    std::exception_ptr compactorError;
 };
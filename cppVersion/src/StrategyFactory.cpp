@@ -0,0 +1,128 @@
+#include "StrategyFactory.h"
+#include "SingleFileStrategy.h"
+#include "ChunkedFileStrategy.h"
+#include "IndividualFileStrategy.h"
+#include "ShardedFileStrategy.h"
+#include "AppendLogStrategy.h"
+#include "PackedFileStrategy.h"
+#include "BlockCache.h"
+#include "Codec.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+std::vector<StrategySpec> StrategyFactory::all(const BenchmarkConfig& config,
+                                               std::shared_ptr<BlockCache> cache) {
+    size_t chunk = config.recordsPerChunk;
+    size_t workers = config.threads ? config.threads
+                                    : std::max(4u, std::thread::hardware_concurrency());
+    size_t maxShards = config.threads ? config.threads : 16;
+    
+    std::vector<StrategySpec> specs;
+    
+    specs.push_back({"single", "all records in one file + index", [] {
+        return std::make_unique<SingleFileStrategy>("data_single");
+    }});
+    specs.push_back({"single-mmap", "SingleFile read through a memory mapping", [] {
+        return std::make_unique<SingleFileStrategy>("data_single", IoMode::Mmap);
+    }});
+    specs.push_back({"single-direct", "SingleFile with O_DIRECT", [] {
+        return std::make_unique<SingleFileStrategy>("data_single", IoMode::Direct);
+    }});
+    specs.push_back({"chunked", "fixed-size chunk files", [chunk] {
+        return std::make_unique<ChunkedFileStrategy>("data_chunked", chunk);
+    }});
+    specs.push_back({"chunked-direct", "Chunked with O_DIRECT", [chunk] {
+        return std::make_unique<ChunkedFileStrategy>("data_chunked", chunk, 1, IoMode::Direct);
+    }});
+    specs.push_back({"chunked-parallel", "Chunked with --threads workers", [chunk, workers] {
+        return std::make_unique<ChunkedFileStrategy>("data_chunked", chunk, workers);
+    }});
+    
+    // same strategies again with the shared block cache in front of random
+    // reads (each cleans up its own files)
+    specs.push_back({"single-cache", "SingleFile + block cache", [cache] {
+        auto s = std::make_unique<SingleFileStrategy>("data_single");
+        s->setBlockCache(cache);
+        return s;
+    }});
+    specs.push_back({"chunked-cache", "Chunked + block cache", [chunk, cache] {
+        auto s = std::make_unique<ChunkedFileStrategy>("data_chunked", chunk);
+        s->setBlockCache(cache);
+        return s;
+    }});
+    
+    // what the per-record index checksums cost
+    specs.push_back({"single-nocrc", "SingleFile without index checksums", [] {
+        auto s = std::make_unique<SingleFileStrategy>("data_single");
+        s->setChecksums(false);
+        return s;
+    }});
+    specs.push_back({"chunked-nocrc", "Chunked without index checksums", [chunk] {
+        auto s = std::make_unique<ChunkedFileStrategy>("data_chunked", chunk);
+        s->setChecksums(false);
+        return s;
+    }});
+    
+    // fast codec vs the best high-ratio one this build has
+    specs.push_back({"chunked-lz", "Chunked, chunks compressed with the in-tree LZ codec", [chunk] {
+        return std::make_unique<ChunkedFileStrategy>("data_chunked", chunk, 1, IoMode::Buffered, CodecId::Lz);
+    }});
+    specs.push_back({"chunked-best", "Chunked, chunks compressed with zstd or zlib", [chunk] {
+        return std::make_unique<ChunkedFileStrategy>("data_chunked", chunk, 1, IoMode::Buffered,
+                                                     Codec::bestRatio());
+    }});
+    
+    // scaling curve for sharded writes/reads - one shard file per thread
+    for (size_t threads = 1; threads <= maxShards; threads *= 2) {
+        specs.push_back({"sharded", "one file per writer thread, swept 1..--threads", [threads] {
+            return std::make_unique<ShardedFileStrategy>("data_sharded", threads);
+        }});
+    }
+    
+    // cost of each durability level on the same layout
+    specs.push_back({"log-nosync", "checksummed append log, never synced", [] {
+        return std::make_unique<AppendLogStrategy>("data_log", SyncPolicy::None);
+    }});
+    specs.push_back({"log-group", "append log with group commit", [] {
+        return std::make_unique<AppendLogStrategy>("data_log", SyncPolicy::PerBatch);
+    }});
+    specs.push_back({"log-record", "append log, fdatasync per record", [] {
+        return std::make_unique<AppendLogStrategy>("data_log", SyncPolicy::PerRecord);
+    }});
+    
+    // the same per-record files, packed into 64MB packs instead of one inode each
+    specs.push_back({"packed", "named records packed into large files with an embedded directory", [] {
+        return std::make_unique<PackedFileStrategy>("data_packed");
+    }});
+    specs.push_back({"individual", "one file per record", [] {
+        return std::make_unique<IndividualFileStrategy>("data_individual");
+    }});
+    specs.push_back({"individual-uring", "Individual through io_uring", [] {
+        return std::make_unique<IndividualFileStrategy>("data_individual", IoEngine::IoUring, 256);
+    }});
+    specs.push_back({"individual-threads", "Individual through a thread pool", [] {
+        return std::make_unique<IndividualFileStrategy>("data_individual", IoEngine::ThreadPool, 32);
+    }});
+    
+    return specs;
+}
+
+std::vector<StrategySpec> StrategyFactory::select(const BenchmarkConfig& config,
+                                                  std::shared_ptr<BlockCache> cache) {
+    auto specs = all(config, cache);
+    if (config.strategies.empty()) return specs;
+    
+    for (const auto& name : config.strategies) {
+        bool known = std::any_of(specs.begin(), specs.end(),
+                                 [&](const StrategySpec& s) { return s.key == name; });
+        if (!known) throw std::invalid_argument("unknown strategy '" + name + "' (see --list)");
+    }
+    
+    std::vector<StrategySpec> selected;
+    for (auto& spec : specs) {
+        if (std::find(config.strategies.begin(), config.strategies.end(), spec.key) != config.strategies.end())
+            selected.push_back(std::move(spec));
+    }
+    return selected;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "StorageStrategy.h"
+#include "BenchmarkConfig.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+class BlockCache;
+
+// one runnable strategy configuration. Several specs can share a key
+// (the sharded thread sweep is all "sharded").
+struct StrategySpec {
+    std::string key;
+    std::string description;
+    std::function<std::unique_ptr<StorageStrategy>()> make;
+};
+
+class StrategyFactory {
+public:
+    // every strategy in the default run order, set up from config. The
+    // +cache variants share `cache`.
+    static std::vector<StrategySpec> all(const BenchmarkConfig& config,
+                                         std::shared_ptr<BlockCache> cache);
+    
+    // the ones config.strategies names (all if none), in run order.
+    // Throws std::invalid_argument on an unknown name.
+    static std::vector<StrategySpec> select(const BenchmarkConfig& config,
+                                            std::shared_ptr<BlockCache> cache);
+};
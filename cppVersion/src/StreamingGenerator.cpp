@@ -0,0 +1,230 @@
+#include "StreamingGenerator.h"
+#include "Checksum.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace {
+constexpr uint64_t golden = 0x9E3779B97F4A7C15ull;
+constexpr double meanRun = 32.0;  // same run lengths as DataGenerator
+constexpr double pi = 3.14159265358979323846;
+constexpr int geometricBits = 12;         // run length lookup table has 2^12 buckets
+constexpr uint32_t inexact = 0xFFFFFFFF;  // bucket straddles two lengths
+
+size_t inverseGeometric(uint64_t bits, double logFail);
+
+// splitmix64 finalizer
+uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// word n of a record's stream is a pure function of (seed, id, n), so
+// nothing has to be replayed to get at record id
+class Counter {
+public:
+    Counter(uint64_t seed, int id)
+        : key(mix64(seed * golden) ^ mix64(static_cast<uint64_t>(id) + golden)) {}
+    
+    uint64_t next() { return mix64(key + golden * ++n); }
+    
+    // the next four words at once. They don't depend on each other, so the
+    // multiplies overlap (and vectorize where there are 64-bit vector
+    // multiplies)
+    void next4(uint64_t* out) {
+        for (int k = 0; k < 4; ++k) out[k] = mix64(key + golden * (n + 1 + k));
+        n += 4;
+    }
+    
+    // failures before the first success, like std::geometric_distribution.
+    // logFail is log(1 - p), -inf when p is 1 (and then no word is used)
+    size_t geometric(double logFail, const std::vector<uint32_t>& table) {
+        if (std::isinf(logFail)) return 0;
+        uint64_t bits = next() >> 11;
+        uint32_t hit = table[bits >> (53 - geometricBits)];
+        return hit != inexact ? hit : inverseGeometric(bits, logFail);
+    }
+    
+private:
+    uint64_t key;
+    uint64_t n = 0;
+};
+
+// floor(log(1 - u) / log(1 - p)) for u = bits / 2^53
+size_t inverseGeometric(uint64_t bits, double logFail) {
+    double len = std::floor(std::log1p(-(bits * 0x1.0p-53)) / logFail);
+    return len < 1e15 ? static_cast<size_t>(len) : static_cast<size_t>(1e15);
+}
+
+// The inverse CDF is monotonic in u, so wherever it comes out the same at
+// both ends of a bucket of u it's that value for the whole bucket. Those
+// buckets become a lookup; only the rest need the log.
+std::vector<uint32_t> geometricTable(double logFail) {
+    std::vector<uint32_t> table(size_t(1) << geometricBits, inexact);
+    if (std::isinf(logFail)) return table;
+    for (uint64_t k = 0; k < table.size(); ++k) {
+        uint64_t lo = k << (53 - geometricBits);
+        uint64_t hi = ((k + 1) << (53 - geometricBits)) - 1;
+        size_t first = inverseGeometric(lo, logFail);
+        if (first == inverseGeometric(hi, logFail) && first < inexact) table[k] = static_cast<uint32_t>(first);
+    }
+    return table;
+}
+
+double runLog(double share) {
+    double p = 1.0 / (1.0 + meanRun * share);
+    return p >= 1.0 ? -std::numeric_limits<double>::infinity() : std::log1p(-p);
+}
+
+// whole words of noise, the tail of the last word is dropped
+void fillNoise(Counter& rng, char* dest, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint64_t w[4];
+        rng.next4(w);
+        std::memcpy(dest + i, w, 32);
+    }
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w = rng.next();
+        std::memcpy(dest + i, &w, 8);
+    }
+    if (i < len) {
+        uint64_t w = rng.next();
+        std::memcpy(dest + i, &w, len - i);
+    }
+}
+}
+
+StreamingGenerator::StreamingGenerator(uint64_t seed, double compressibility,
+                                       size_t minSize, size_t maxSize, SizeDistribution sizes)
+    : seed(seed), compressibility(compressibility), minSize(minSize), maxSize(maxSize), sizes(sizes),
+      logMedian(std::log(minSize + (maxSize - minSize) / 4.0 + 1.0)),
+      quietLog(runLog(compressibility)), noisyLog(runLog(1.0 - compressibility)),
+      quietTable(geometricTable(quietLog)), noisyTable(geometricTable(noisyLog)) {
+    if (compressibility < 0.0 || compressibility > 1.0)
+        throw std::invalid_argument("compressibility must be between 0 and 1");
+    if (minSize == 0 || minSize > maxSize)
+        throw std::invalid_argument("record sizes need 0 < minSize <= maxSize");
+}
+
+size_t StreamingGenerator::sizeOf(int id) const {
+    // the size always takes the first two words, whichever distribution
+    Counter rng(seed, id);
+    uint64_t a = rng.next();
+    uint64_t b = rng.next();
+    if (sizes == SizeDistribution::Uniform) return minSize + a % (maxSize - minSize + 1);
+    
+    // Box-Muller, sigma 0.5 like DataGenerator's tail
+    double u1 = 1.0 - (a >> 11) * 0x1.0p-53;  // (0, 1]
+    double u2 = (b >> 11) * 0x1.0p-53;
+    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * pi * u2);
+    double size = std::exp(logMedian + 0.5 * z);
+    return std::clamp(static_cast<size_t>(size), minSize, maxSize);
+}
+
+void StreamingGenerator::fill(int id, Record& out) const {
+    out.id = id;
+    out.data.resize(sizeOf(id));
+    fillPayload(id, out.data.data(), out.data.size());
+}
+
+void StreamingGenerator::fill(int id, char* dest) const {
+    fillPayload(id, dest, sizeOf(id));
+}
+
+void StreamingGenerator::fillPayload(int id, char* data, size_t size) const {
+    Counter rng(seed, id);
+    rng.next();
+    rng.next();  // the size words
+    
+    if (compressibility <= 0.0) {
+        fillNoise(rng, data, size);
+        return;
+    }
+    
+    size_t i = 0;
+    while (i < size) {
+        size_t quiet = std::min(rng.geometric(quietLog, quietTable), size - i);
+        std::memset(data + i, 0, quiet);
+        i += quiet;
+        
+        size_t noisy = std::min(rng.geometric(noisyLog, noisyTable), size - i);
+        fillNoise(rng, data + i, noisy);
+        i += noisy;
+    }
+}
+
+void StreamingGenerator::forEachBlock(size_t count, size_t threads,
+                                      const std::function<void(size_t, size_t)>& task) const {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t blocks = (count + idsPerTask - 1) / idsPerTask;
+    auto block = [&](size_t b) { task(b * idsPerTask, std::min(count, (b + 1) * idsPerTask)); };
+    if (threads == 1 || blocks < 2) {
+        for (size_t b = 0; b < blocks; ++b) block(b);
+        return;
+    }
+    WorkerPool pool(std::min(threads, blocks));
+    pool.parallelFor(blocks, block);
+}
+
+std::vector<Record> StreamingGenerator::generateRecords(size_t count, size_t threads) const {
+    std::vector<Record> records(count);
+    forEachBlock(count, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) fill(static_cast<int>(i), records[i]);
+    });
+    return records;
+}
+
+void StreamingGenerator::generateBatch(size_t count, RecordBatch& out, size_t threads) const {
+    // sizes first, so every payload has its place in the arena before the
+    // threads start filling
+    std::vector<size_t> sizes(count);
+    forEachBlock(count, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) sizes[i] = sizeOf(static_cast<int>(i));
+    });
+    
+    size_t total = 0;
+    for (size_t size : sizes) total += size;
+    out.clear();
+    out.reserve(count, total);
+    std::vector<char*> dest(count);
+    for (size_t i = 0; i < count; ++i) dest[i] = out.append(static_cast<int>(i), sizes[i]);
+    
+    forEachBlock(count, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) fillPayload(static_cast<int>(i), dest[i], sizes[i]);
+    });
+}
+
+std::vector<uint32_t> StreamingGenerator::checksums(size_t count, size_t threads) const {
+    std::vector<uint32_t> crcs(count);
+    forEachBlock(count, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) crcs[i] = checksum(static_cast<int>(i));
+    });
+    return crcs;
+}
+
+Record StreamingGenerator::generate(int id) const {
+    Record record;
+    fill(id, record);
+    return record;
+}
+
+uint32_t StreamingGenerator::checksum(int id) const {
+    thread_local Record scratch;
+    fill(id, scratch);
+    return crc32c(scratch.data.data(), scratch.data.size());
+}
+
+const Record* GeneratedRecordStream::next() {
+    if (pos >= count) return nullptr;
+    auto start = std::chrono::steady_clock::now();
+    generator.fill(static_cast<int>(pos++), current);
+    generationTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return &current;
+}
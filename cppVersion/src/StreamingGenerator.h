@@ -0,0 +1,82 @@
+#pragma once
+#include "Record.h"
+#include "RecordStream.h"
+#include "DataGenerator.h"
+#include "RecordBatch.h"
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// Regenerates any record from (seed, id) alone with a counter-based RNG, so
+// datasets far bigger than RAM can be written and checked on the way back
+// without ever holding them. The knobs mean the same as DataGenerator's but
+// the bytes differ - DataGenerator is one sequential mt19937 stream and
+// record N depends on everything before it.
+//
+// Since records don't depend on each other, generateRecords/generateBatch
+// split the id range over threads and still produce the same bytes for any
+// thread count.
+class StreamingGenerator {
+public:
+    StreamingGenerator(uint64_t seed = 24, double compressibility = 0.0,
+                       size_t minSize = 1024, size_t maxSize = 2048,
+                       SizeDistribution sizes = SizeDistribution::Uniform);
+    
+    size_t sizeOf(int id) const;
+    // out.data is resized, so a record reused across calls doesn't reallocate
+    void fill(int id, Record& out) const;
+    // dest needs room for sizeOf(id) bytes
+    void fill(int id, char* dest) const;
+    Record generate(int id) const;
+    
+    // records 0..count-1 on `threads` threads (0 = one per core)
+    std::vector<Record> generateRecords(size_t count, size_t threads = 0) const;
+    void generateBatch(size_t count, RecordBatch& out, size_t threads = 0) const;
+    // checksum(id) for ids 0..count-1
+    std::vector<uint32_t> checksums(size_t count, size_t threads = 0) const;
+    // crc32c of record id's payload
+    uint32_t checksum(int id) const;
+    
+private:
+    // ids are handed to threads in blocks this big
+    static constexpr size_t idsPerTask = 1024;
+    
+    uint64_t seed;
+    double compressibility;
+    size_t minSize;
+    size_t maxSize;
+    SizeDistribution sizes;
+    double logMedian;
+    // log(1 - p) of the quiet/noisy run length distributions
+    double quietLog;
+    double noisyLog;
+    // run lengths for the buckets where no log() is needed, see the .cpp
+    std::vector<uint32_t> quietTable;
+    std::vector<uint32_t> noisyTable;
+    
+    void fillPayload(int id, char* data, size_t size) const;
+    // task(first, last) over blocks of ids, on a pool when threads > 1
+    void forEachBlock(size_t count, size_t threads,
+                      const std::function<void(size_t, size_t)>& task) const;
+};
+
+// the first `count` records of a generator, in id order. Keeps track of the
+// time spent generating so callers can take it back out of a write timing.
+class GeneratedRecordStream : public RecordStream {
+public:
+    GeneratedRecordStream(const StreamingGenerator& generator, size_t count)
+        : generator(generator), count(count) {}
+    
+    size_t size() const override { return count; }
+    const Record* next() override;
+    
+    double generationSeconds() const { return generationTime; }
+    
+private:
+    const StreamingGenerator& generator;
+    size_t count;
+    size_t pos = 0;
+    Record current;
+    double generationTime = 0.0;
+};
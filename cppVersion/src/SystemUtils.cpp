@@ -3,6 +3,8 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
 void SystemUtils::clearCaches() {
@@ -31,3 +33,18 @@ std::string SystemUtils::getSystemInfo() {
 #endif
     return info;
 }
+
+std::string SystemUtils::getHostName() {
+#ifdef _WIN32
+    char name[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD size = sizeof(name);
+    if (GetComputerNameA(name, &size)) return std::string(name, size);
+#else
+    char name[256];
+    if (gethostname(name, sizeof(name)) == 0) {
+        name[sizeof(name) - 1] = '\0';
+        return name;
+    }
+#endif
+    return "unknown";
+}
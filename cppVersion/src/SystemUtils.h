@@ -5,4 +5,5 @@ class SystemUtils {
 public:
     static void clearCaches();
     static std::string getSystemInfo();
+    static std::string getHostName();
 };
@@ -0,0 +1,110 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::Job::Job(const std::function<void(size_t)>& task, size_t count, size_t slices)
+    : task(task), ranges(slices), remaining(count) {
+    for (size_t w = 0; w < slices; ++w) {
+        ranges[w].begin = count * w / slices;
+        ranges[w].end   = count * (w + 1) / slices;
+    }
+}
+
+WorkerPool::WorkerPool(size_t numThreads) {
+    size_t n = std::max<size_t>(1, numThreads);
+    workers.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        workers.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+    
+    auto job = std::make_shared<Job>(task, count, workers.size());
+    std::unique_lock<std::mutex> lock(mtx);
+    jobs.push_back(job);
+    wake.notify_all();
+    
+    finished.wait(lock, [&] { return job->done; });
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+bool WorkerPool::takeTask(Job& job, size_t self, size_t& task) {
+    do {
+        Range& mine = job.ranges[self];
+        std::lock_guard<std::mutex> lock(mine.m);
+        if (mine.begin < mine.end) {
+            task = mine.begin++;
+            return true;
+        }
+    } while (steal(job, self));
+    return false;
+}
+
+bool WorkerPool::steal(Job& job, size_t self) {
+    size_t n = job.ranges.size();
+    for (size_t k = 1; k < n; ++k) {
+        Range& victim = job.ranges[(self + k) % n];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (victim.begin >= victim.end) continue;
+            // take the back half, or the last task if that's all there is
+            end = victim.end;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            victim.end = begin;
+        }
+        // only ever hold one range lock at a time
+        Range& mine = job.ranges[self];
+        std::lock_guard<std::mutex> lock(mine.m);
+        mine.begin = begin;
+        mine.end = end;
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::workerLoop(size_t self) {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = jobs.front();
+        }
+        
+        size_t i;
+        while (takeTask(*job, self, i)) {
+            // after a failure the rest is only counted off, not run
+            if (!job->cancelled) {
+                try {
+                    job->task(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (!job->error) job->error = std::current_exception();
+                    job->cancelled = true;
+                }
+            }
+            if (job->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mtx);
+                job->done = true;
+                finished.notify_all();
+            }
+        }
+        
+        // nothing left to hand out; tasks other workers are still running
+        // finish without us
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!jobs.empty() && jobs.front() == job) jobs.pop_front();
+    }
+}
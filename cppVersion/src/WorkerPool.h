@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <exception>
+#include <cstddef>
+
+// Fixed set of worker threads for fanning independent tasks out. Threads
+// live as long as the pool so repeated parallelFor calls don't pay for
+// thread creation.
+//
+// Each worker starts on its own contiguous slice of the task range (so
+// neighbouring tasks, e.g. adjacent chunks, stay on one thread) and once
+// it runs dry it steals the back half of another worker's remaining slice.
+// Several threads can call parallelFor at once: every call is a job of its
+// own, queued behind the ones already running. Don't call it from inside a
+// task.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t numThreads);
+    ~WorkerPool();
+    
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    size_t size() const { return workers.size(); }
+    
+    // runs task(i) for every i in [0, count) and blocks until all are done.
+    // The first exception thrown by a task is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+    
+private:
+    // what's left of one worker's slice. Owner takes from the front,
+    // thieves split off the back.
+    struct alignas(64) Range {
+        std::mutex m;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+    
+    // one parallelFor call
+    struct Job {
+        Job(const std::function<void(size_t)>& task, size_t count, size_t slices);
+        
+        const std::function<void(size_t)>& task;
+        std::vector<Range> ranges;
+        std::atomic<size_t> remaining;  // tasks not finished (or skipped) yet
+        std::atomic<bool> cancelled{false};
+        std::exception_ptr error;       // guarded by the pool's mtx
+        bool done = false;              // same
+    };
+    
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::deque<std::shared_ptr<Job>> jobs;  // oldest first, guarded by mtx
+    bool stopping = false;
+    
+    void workerLoop(size_t self);
+    bool takeTask(Job& job, size_t self, size_t& task);
+    bool steal(Job& job, size_t self);
+};
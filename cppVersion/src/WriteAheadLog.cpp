@@ -0,0 +1,215 @@
+#include "WriteAheadLog.h"
+#include "Checksum.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+WriteAheadLog::WriteAheadLog(const std::string& path, const Options& options)
+    : options(options) {
+#ifdef _WIN32
+    fd = _open(path.c_str(), _O_BINARY | _O_WRONLY | _O_CREAT | _O_TRUNC, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) throw std::runtime_error("cant open log file: " + path);
+    
+    pending.reserve(options.groupCommitBytes + 4096);
+    if (options.policy == SyncPolicy::PerBatch) {
+        flusher = std::thread(&WriteAheadLog::flusherLoop, this);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        close();
+    } catch (...) {
+        // nothing sensible to do with it in a destructor
+    }
+}
+
+double WriteAheadLog::seconds(Clock::time_point t) {
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+uint64_t WriteAheadLog::append(int id, const char* data, size_t size) {
+    if (size > UINT32_MAX) throw std::runtime_error("record too large for log frame");
+    
+    char header[headerSize];
+    uint32_t len = static_cast<uint32_t>(size);
+    uint32_t crc = crc32c(data, size);
+    std::memcpy(header,     &len, 4);
+    std::memcpy(header + 4, &id,  4);
+    std::memcpy(header + 8, &crc, 4);
+    
+    auto now = Clock::now();
+    std::unique_lock<std::mutex> lock(mtx);
+    if (closed) throw std::logic_error("append to closed log");
+    if (flushError) std::rethrow_exception(flushError);
+    
+    uint64_t payloadOffset = appended + headerSize;
+    pending.insert(pending.end(), header, header + headerSize);
+    pending.insert(pending.end(), data, data + size);
+    appended += headerSize + size;
+    
+    if (options.policy == SyncPolicy::PerRecord) {
+        writeOut(pending.data(), pending.size());
+        pending.clear();
+        sync();
+        durable = appended;
+        recordCommit(1, seconds(now), now, Clock::now());
+        return payloadOffset;
+    }
+    
+    bool firstInBatch = pendingRecords == 0;
+    if (firstInBatch) pendingSince = now;
+    ++pendingRecords;
+    pendingAppendTimes += seconds(now);
+    
+    if (options.policy == SyncPolicy::None) {
+        if (pending.size() >= options.groupCommitBytes) {
+            writeOut(pending.data(), pending.size());
+            pending.clear();
+            pendingRecords = 0;
+            pendingAppendTimes = 0.0;
+        }
+    } else if (firstInBatch || pending.size() >= options.groupCommitBytes) {
+        // the first record starts the flusher's groupCommitDelay clock, a
+        // full batch cuts it short
+        flushWanted.notify_one();
+    }
+    
+    return payloadOffset;
+}
+
+void WriteAheadLog::waitDurable(uint64_t offset) {
+    // without a sync policy nothing ever becomes durable, don't hang
+    if (options.policy == SyncPolicy::None) return;
+    
+    std::unique_lock<std::mutex> lock(mtx);
+    durableChanged.wait(lock, [&] { return durable >= offset || flushError; });
+    if (flushError) std::rethrow_exception(flushError);
+}
+
+void WriteAheadLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    std::vector<char> batch;
+    batch.reserve(pending.capacity());
+    
+    while (true) {
+        flushWanted.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (pending.empty()) break;  // stopping and nothing left to write
+        
+        // let the batch fill up until it's big enough or has waited long enough
+        auto deadline = pendingSince + options.groupCommitDelay;
+        flushWanted.wait_until(lock, deadline, [&] {
+            return stopping || pending.size() >= options.groupCommitBytes;
+        });
+        
+        batch.swap(pending);
+        size_t records = pendingRecords;
+        double appendTimes = pendingAppendTimes;
+        auto oldest = pendingSince;
+        uint64_t end = appended;
+        pendingRecords = 0;
+        pendingAppendTimes = 0.0;
+        
+        // appends carry on into the other buffer while this one syncs
+        lock.unlock();
+        try {
+            writeOut(batch.data(), batch.size());
+            sync();
+        } catch (...) {
+            lock.lock();
+            flushError = std::current_exception();
+            durableChanged.notify_all();
+            return;
+        }
+        auto committed = Clock::now();
+        batch.clear();
+        lock.lock();
+        
+        durable = end;
+        recordCommit(records, appendTimes, oldest, committed);
+        durableChanged.notify_all();
+    }
+}
+
+void WriteAheadLog::recordCommit(size_t records, double appendTimes,
+                                 Clock::time_point oldest, Clock::time_point committed) {
+    statistics.records += records;
+    statistics.syncs++;
+    statistics.totalCommitLatency += records * seconds(committed) - appendTimes;
+    statistics.maxCommitLatency = std::max(statistics.maxCommitLatency,
+                                           std::chrono::duration<double>(committed - oldest).count());
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed) return;
+        closed = true;
+        stopping = true;
+    }
+    flushWanted.notify_all();
+    if (flusher.joinable()) flusher.join();
+    
+    // only None leaves anything behind, the flusher drains the rest
+    if (!flushError && !pending.empty()) {
+        writeOut(pending.data(), pending.size());
+        pending.clear();
+    }
+    
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    fd = -1;
+    
+    if (flushError) std::rethrow_exception(flushError);
+}
+
+uint64_t WriteAheadLog::appendedBytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return appended;
+}
+
+WriteAheadLog::Stats WriteAheadLog::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return statistics;
+}
+
+void WriteAheadLog::writeOut(const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        int n = _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) throw std::runtime_error(std::string("log write failed: ") + std::strerror(errno));
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void WriteAheadLog::sync() {
+#ifdef _WIN32
+    int rc = _commit(fd);
+#elif defined(__APPLE__)
+    int rc = fsync(fd);
+#else
+    int rc = fdatasync(fd);
+#endif
+    if (rc != 0) throw std::runtime_error(std::string("log sync failed: ") + std::strerror(errno));
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+
+enum class SyncPolicy {
+    None,       // never fdatasync, durability is whatever the page cache does
+    PerBatch,   // group commit: one fdatasync per batch (size or time threshold)
+    PerRecord   // write + fdatasync for every single record
+};
+
+// Append-only log of framed records:
+//
+//   [uint32 length][int32 id][uint32 crc32c(payload)][payload...]
+//
+// in native byte order. With PerBatch, appends go into an in-memory batch
+// and a background thread writes + syncs it once it reaches
+// groupCommitBytes or the oldest record has waited groupCommitDelay,
+// whichever comes first. Appending continues into a fresh batch while the
+// previous one is being synced.
+class WriteAheadLog {
+public:
+    static constexpr size_t headerSize = 12;
+    
+    struct Options {
+        SyncPolicy policy = SyncPolicy::PerBatch;
+        size_t groupCommitBytes = 1024 * 1024;
+        std::chrono::microseconds groupCommitDelay{1000};
+    };
+    
+    struct Stats {
+        size_t records = 0;
+        size_t syncs = 0;
+        double totalCommitLatency = 0.0;  // sum over records of append -> durable, seconds
+        double maxCommitLatency = 0.0;
+        
+        double avgCommitLatency() const { return records ? totalCommitLatency / records : 0.0; }
+    };
+    
+    // truncates path
+    WriteAheadLog(const std::string& path, const Options& options);
+    ~WriteAheadLog();
+    
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    
+    // Appends one frame and returns the file offset of its payload. With
+    // PerRecord the record is durable when this returns; with PerBatch use
+    // waitDurable(appendedBytes()) if you need to know.
+    uint64_t append(int id, const char* data, size_t size);
+    void waitDurable(uint64_t offset);
+    
+    // writes (and with a sync policy, syncs) everything still buffered
+    void close();
+    
+    uint64_t appendedBytes() const;
+    Stats stats() const;
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    Options options;
+    int fd = -1;
+    bool closed = false;
+    
+    mutable std::mutex mtx;
+    std::condition_variable flushWanted;
+    std::condition_variable durableChanged;
+    std::thread flusher;
+    bool stopping = false;
+    std::exception_ptr flushError;   // set if the flusher thread failed
+    
+    std::vector<char> pending;       // frames not yet handed to the kernel
+    size_t pendingRecords = 0;
+    Clock::time_point pendingSince;  // append time of the oldest pending record
+    double pendingAppendTimes = 0.0; // sum of append times, for the latency stats
+    uint64_t appended = 0;           // bytes appended so far
+    uint64_t durable = 0;            // bytes known to be on disk
+    
+    Stats statistics;
+    
+    void writeOut(const char* data, size_t size);
+    void sync();
+    void flusherLoop();
+    static double seconds(Clock::time_point t);
+    void recordCommit(size_t records, double appendTimes, Clock::time_point oldest,
+                      Clock::time_point committed);
+};
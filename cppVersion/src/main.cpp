@@ -1,39 +1,267 @@
 #include "DataGenerator.h"
+#include "StreamingGenerator.h"
 #include "SingleFileStrategy.h"
 #include "ChunkedFileStrategy.h"
-#include "IndividualFileStrategy.h"
+#include "BenchmarkConfig.h"
+#include "StrategyFactory.h"
+#include "ResultWriter.h"
 #include "BenchmarkTimer.h"
 #include "BenchmarkMetrics.h"
 #include "DataValidator.h"
+#include "BlockCache.h"
+#include "AccessPattern.h"
+#include "Checksum.h"
+#include "RecordBatch.h"
+#include <cstring>
 #include <iostream>
 #include <iomanip>
-#include <random>
 #include <algorithm>
-#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <memory>
+#include <exception>
+
+// strategy name plus whatever was switched on or off from outside
+std::string displayName(const StorageStrategy* strategy) {
+    std::string name = strategy->getName();
+    if (strategy->getBlockCache()) name += "+cache";
+    if (strategy->storesChecksums() && !strategy->checksumsEnabled()) name += "-nocrc";
+    return name;
+}
+
+// what a reader pays just to hold the dataset: copy every record into a
+// std::vector<Record> vs. a RecordBatch, then free it. Twice, since the
+// second round runs on memory the first one already faulted in.
+void printAllocationCost(const std::vector<Record>& records) {
+    BenchmarkTimer timer;
+    std::vector<Record> copy;
+    RecordBatch batch;
+    
+    std::cout << "Record layout, copying " << records.size() << " records:" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const char* round : {"cold", "warm"}) {
+        timer.start();
+        copy.reserve(records.size());
+        for (const auto& r : records) {
+            copy.emplace_back(r.id, r.data.size());
+            std::memcpy(copy.back().data.data(), r.data.data(), r.data.size());
+        }
+        timer.stop();
+        double vectorBuild = timer.getElapsedSeconds();
+        timer.start();
+        copy.clear();
+        timer.stop();
+        double vectorFree = timer.getElapsedSeconds();
+        
+        timer.start();
+        for (const auto& r : records) batch.append(RecordView(r.id, r.data.data(), r.data.size()));
+        timer.stop();
+        double arenaBuild = timer.getElapsedSeconds();
+        size_t slabs = batch.arena().slabCount();
+        timer.start();
+        batch.clear();
+        timer.stop();
+        double arenaFree = timer.getElapsedSeconds();
+        
+        std::cout << "  " << round << "  vector<Record> " << std::setw(8) << vectorBuild * 1000.0
+                  << "ms + free " << std::setw(6) << vectorFree * 1000.0 << "ms ("
+                  << 1e9 * (vectorBuild + vectorFree) / records.size() << "ns/record)\n"
+                  << "  " << round << "  RecordBatch    " << std::setw(8) << arenaBuild * 1000.0
+                  << "ms + free " << std::setw(6) << arenaFree * 1000.0 << "ms ("
+                  << 1e9 * (arenaBuild + arenaFree) / records.size() << "ns/record, "
+                  << slabs << " slabs)" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// the random read indices again, one readOne() at a time. check() says
+// whether a record is right.
+void runPointLookups(StorageStrategy* strategy, const std::vector<int>& ids, BenchmarkMetrics& result,
+                     const std::function<bool(const RecordView&)>& check) {
+    LatencyHistogram hist;
+    bool ok = true;
+    std::cout << "    Point lookups..." << std::flush;
+    for (int id : ids) {
+        uint64_t start = OpClock::now();
+        Record record = strategy->readOne(id);
+        hist.record(OpClock::toNanos(OpClock::now() - start));
+        if (ok && !check(RecordView(record.id, record.data.data(), record.data.size()))) ok = false;
+    }
+    result.pointReadLat = hist.summary();
+    std::cout << " Done (mean " << result.pointReadLat.mean << "us)" << std::endl;
+    
+    if (!ok) {
+        std::cerr << "    WARNING: point lookup verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+}
 
-// keep same seed as generator so results are reproducible
-std::vector<int> generateRandomIndices(size_t count, size_t max, unsigned int seed = 24) {
-    std::vector<int> indices;
-    indices.reserve(count);
+// rewrites the random read indices in place (payload reversed), removes
+// every tenth of them, then compacts (where the strategy can) and reads
+// them all back. With autoCompact > 0 the updates start compactions on the
+// background thread as they go, while another thread reads random records
+// and checks each is the old or the new version (or gone, once removed).
+void runUpdates(StorageStrategy* strategy, const std::vector<Record>& records,
+                const std::vector<int>& ids, double autoCompact, BenchmarkMetrics& result) {
+    std::vector<int> distinct(ids);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    
+    bool background = autoCompact > 0.0 && strategy->supportsCompaction();
+    std::vector<char> touched(records.size(), 0);
+    for (int id : distinct) touched[id] = 1;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> readerOk{true};
+    std::thread reader;
+    size_t compactionsBefore = strategy->getCompactions();
+    if (background) {
+        strategy->setAutoCompaction(autoCompact);
+        reader = std::thread([&] {
+            std::mt19937 rng(static_cast<unsigned int>(records.size()));
+            std::uniform_int_distribution<int> pick(0, static_cast<int>(records.size()) - 1);
+            try {
+                while (!stop.load(std::memory_order_relaxed) && readerOk) {
+                    int id = pick(rng);
+                    const auto& data = records[id].data;
+                    try {
+                        Record record = strategy->readOne(id);
+                        bool same = record.data == data;
+                        bool reversed = touched[id] && std::equal(record.data.begin(), record.data.end(),
+                                                                  data.rbegin(), data.rend());
+                        if (record.id != id || record.data.size() != data.size() || !(same || reversed))
+                            readerOk = false;
+                    } catch (const std::out_of_range&) {
+                        if (!touched[id]) readerOk = false;
+                    }
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "\n    WARNING: reader during background compaction failed: " << e.what();
+                readerOk = false;
+            }
+        });
+    }
     
-    std::mt19937 rng(seed);
-    std::uniform_int_distribution<int> dist(0, max - 1);
+    LatencyHistogram hist;
+    std::cout << "    Updates..." << std::flush;
+    try {
+        for (size_t i = 0; i < distinct.size(); ++i) {
+            int id = distinct[i];
+            std::vector<char> data(records[id].data.rbegin(), records[id].data.rend());
+            uint64_t start = OpClock::now();
+            if (i % 10 == 9) {
+                strategy->remove(id);
+            } else {
+                strategy->update(id, data);
+            }
+            hist.record(OpClock::toNanos(OpClock::now() - start));
+        }
+    } catch (...) {
+        stop = true;
+        if (reader.joinable()) reader.join();
+        strategy->setAutoCompaction(0.0);
+        throw;
+    }
+    result.updateLat = hist.summary();
+    
+    bool ok = true;
+    if (background) {
+        try {
+            strategy->waitForCompaction();
+        } catch (const std::exception& e) {
+            std::cerr << "\n    WARNING: background compaction failed: " << e.what();
+            ok = false;
+        }
+        strategy->setAutoCompaction(0.0);
+        stop = true;
+        reader.join();
+        if (!readerOk) ok = false;
+        result.backgroundCompactions = strategy->getCompactions() - compactionsBefore;
+    }
+    result.deadBytes = strategy->getDeadBytes();
+    std::cout << " Done (mean " << result.updateLat.mean << "us, "
+              << result.deadBytes / 1024 << " KB dead";
+    if (background) std::cout << ", " << result.backgroundCompactions << " compactions in the background";
+    std::cout << ")" << std::endl;
     
-    for (size_t i = 0; i < count; ++i) {
-        indices.push_back(dist(rng));
+    if (strategy->supportsCompaction()) {
+        BenchmarkTimer timer;
+        std::cout << "    Compaction..." << std::flush;
+        timer.start();
+        result.reclaimedBytes = strategy->compact(0.0);
+        timer.stop();
+        result.compacted = true;
+        result.compactTime = timer.getElapsedSeconds();
+        std::cout << " Done (" << result.compactTime << "s)" << std::endl;
     }
     
-    return indices;
+    for (size_t i = 0; i < distinct.size() && ok; ++i) {
+        int id = distinct[i];
+        if (i % 10 == 9) {
+            try {
+                strategy->readOne(id);
+                ok = false;
+            } catch (const std::out_of_range&) {
+            }
+            continue;
+        }
+        Record record = strategy->readOne(id);
+        ok = std::equal(record.data.begin(), record.data.end(),
+                        records[id].data.rbegin(), records[id].data.rend());
+    }
+    size_t scanned = 0;
+    strategy->scanSequential([&](const RecordView&) { ++scanned; });
+    if (!ok || scanned != records.size() - distinct.size() / 10) {
+        std::cerr << "    WARNING: update verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
 }
 
-BenchmarkMetrics runBenchmark(StorageStrategy* strategy, const std::vector<Record>& records, size_t totalDataSize) {
+// the whole dataset again, into an empty store through append() a batch at
+// a time, the way continuous ingestion would write it
+void runAppends(StorageStrategy* strategy, const std::vector<Record>& records, BenchmarkMetrics& result) {
+    constexpr size_t batchSize = 1000;
+    strategy->cleanUp();
+    
+    BenchmarkTimer timer;
+    std::cout << "    Appending in batches of " << batchSize << "..." << std::flush;
+    std::vector<Record> batch;
+    timer.start();
+    for (size_t first = 0; first < records.size(); first += batchSize) {
+        size_t end = std::min(records.size(), first + batchSize);
+        batch.assign(records.begin() + first, records.begin() + end);
+        strategy->append(batch);
+    }
+    timer.stop();
+    result.appendTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.appendTime << "s)" << std::endl;
+    
+    if (!DataValidator::verifyRecords(records, strategy->readSequential())) {
+        std::cerr << "    WARNING: append verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+}
+
+BenchmarkMetrics runBenchmark(StorageStrategy* strategy, const std::vector<Record>& records,
+                              size_t totalDataSize, const std::vector<int>& randomIndices,
+                              double autoCompact) {
     BenchmarkMetrics result;
-    result.strategy = strategy->getName();
+    result.strategy = displayName(strategy);
     result.totalDataSize = totalDataSize;
+    result.numRecords = records.size();
+    BlockCache* cache = strategy->getBlockCache();
+    
+    // per-record timing for write/readSequential/readRandom (not the scans)
+    OpLatencies latencies;
+    strategy->setLatencyRecorder(&latencies);
     BenchmarkTimer timer;
     
     // std::cout << "DEBUG: starting " << strategy->getName() << std::endl;
-    std::cout << "  Testing " << strategy->getName() << " strategy..." << std::endl;
+    std::cout << "  Testing " << result.strategy << " strategy..." << std::endl;
     
     std::cout << "    Writing..." << std::flush;
     timer.start();
@@ -44,6 +272,12 @@ BenchmarkMetrics runBenchmark(StorageStrategy* strategy, const std::vector<Recor
     
     result.diskSpaceUsed = strategy->getDiskSpaceUsed();
     result.numFiles = strategy->getNumFiles();
+    result.paddingBytes = strategy->getPaddingBytes();
+    
+    DurabilityStats durability = strategy->getDurabilityStats();
+    result.syncCount = durability.syncs;
+    result.avgCommitLatency = durability.avgCommitLatency;
+    result.maxCommitLatency = durability.maxCommitLatency;
     
     std::cout << "    Sequential read..." << std::flush;
     timer.start();
@@ -57,7 +291,29 @@ BenchmarkMetrics runBenchmark(StorageStrategy* strategy, const std::vector<Recor
         std::cerr << "    WARNING: sequential read verification failed!" << std::endl;
     }
     
-    auto randomIndices = generateRandomIndices(1000, records.size());
+    result.writeLat = latencies.write.summary();
+    result.seqReadLat = latencies.seqRead.summary();
+    
+    seqRecords = std::vector<Record>();
+    
+    // after the summary: strategies without a scan path fall back to
+    // readSequential, which would count twice
+    std::cout << "    Sequential read (arena)..." << std::flush;
+    timer.start();
+    RecordBatch seqBatch;
+    strategy->readSequentialBatch(seqBatch);
+    timer.stop();
+    result.seqReadBatchTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.seqReadBatchTime << "s)" << std::endl;
+    
+    if (!DataValidator::verifyRecords(records, seqBatch)) {
+        std::cerr << "    WARNING: arena sequential read verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+    seqBatch = RecordBatch();
+    
+    result.numRandomReads = randomIndices.size();
+    if (cache) cache->resetStats();
     std::cout << "    Random read..." << std::flush;
     timer.start();
     auto randRecords = strategy->readRandom(randomIndices);
@@ -65,32 +321,545 @@ BenchmarkMetrics runBenchmark(StorageStrategy* strategy, const std::vector<Recor
     result.randReadTime = timer.getElapsedSeconds();
     std::cout << " Done (" << result.randReadTime << "s)" << std::endl;
     
+    result.randReadLat = latencies.randRead.summary();
+    strategy->setLatencyRecorder(nullptr);
+    
     if (!DataValidator::verifySubset(records, randRecords, randomIndices)) {
         std::cerr << "    WARNING: random read verification failed!" << std::endl;
         result.dataVerified = false;
     }
     
+    runPointLookups(strategy, randomIndices, result,
+                    [&](const RecordView& view) { return DataValidator::verifyView(records, view); });
+    
+    // same reads again through the view API
+    bool scanOk = true;
+    size_t scanned = 0;
+    auto checkView = [&](const RecordView& view) {
+        ++scanned;
+        if (scanOk && !DataValidator::verifyView(records, view)) scanOk = false;
+    };
+    
+    std::cout << "    Sequential scan..." << std::flush;
+    timer.start();
+    strategy->scanSequential(checkView);
+    timer.stop();
+    result.scanTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.scanTime << "s)" << std::endl;
+    
+    if (!scanOk || scanned != records.size()) {
+        std::cerr << "    WARNING: sequential scan verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+    
+    scanned = 0;
+    std::cout << "    Random scan..." << std::flush;
+    timer.start();
+    strategy->scanRandom(randomIndices, checkView);
+    timer.stop();
+    result.randScanTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.randScanTime << "s)" << std::endl;
+    
+    if (!scanOk || scanned != randomIndices.size()) {
+        std::cerr << "    WARNING: random scan verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+    
+    if (cache) {
+        BlockCache::Stats stats = cache->stats();
+        result.cacheEnabled = true;
+        result.cacheHits = stats.hits;
+        result.cacheMisses = stats.misses;
+        result.cacheEvictions = stats.evictions;
+    }
+    
+    FileHandleStats handles = strategy->getFileHandleStats();
+    result.fdOpens = handles.opens;
+    result.fdReuses = handles.reuses;
+    result.fdEvictions = handles.evictions;
+    
+    if (strategy->supportsUpdates()) {
+        runUpdates(strategy, records, randomIndices, autoCompact, result);
+        runAppends(strategy, records, result);
+    }
+    
+    strategy->cleanUp();
+    return result;
+}
+
+// Same phases as runBenchmark without ever holding the dataset: records are
+// regenerated as the strategy pulls them and everything read back is
+// checked against one crc32c per record. The sequential read is the scan,
+// readSequential would materialize everything.
+BenchmarkMetrics runStreamingBenchmark(StorageStrategy* strategy, const StreamingGenerator& generator,
+                                       const std::vector<uint32_t>& checksums, size_t totalDataSize,
+                                       const std::vector<int>& randomIndices) {
+    BenchmarkMetrics result;
+    result.strategy = displayName(strategy);
+    result.totalDataSize = totalDataSize;
+    result.numRecords = checksums.size();
+    BlockCache* cache = strategy->getBlockCache();
+    
+    OpLatencies latencies;
+    strategy->setLatencyRecorder(&latencies);
+    BenchmarkTimer timer;
+    
+    std::cout << "  Testing " << result.strategy << " strategy (streaming)..." << std::endl;
+    
+    // generation happens inside write(), take it back out
+    std::cout << "    Writing..." << std::flush;
+    GeneratedRecordStream stream(generator, checksums.size());
+    timer.start();
+    strategy->writeStream(stream);
+    timer.stop();
+    result.writeTime = std::max(0.0, timer.getElapsedSeconds() - stream.generationSeconds());
+    std::cout << " Done (" << result.writeTime << "s, plus "
+              << stream.generationSeconds() << "s generating)" << std::endl;
+    
+    result.diskSpaceUsed = strategy->getDiskSpaceUsed();
+    result.numFiles = strategy->getNumFiles();
+    result.paddingBytes = strategy->getPaddingBytes();
+    
+    DurabilityStats durability = strategy->getDurabilityStats();
+    result.syncCount = durability.syncs;
+    result.avgCommitLatency = durability.avgCommitLatency;
+    result.maxCommitLatency = durability.maxCommitLatency;
+    result.writeLat = latencies.write.summary();
+    
+    bool scanOk = true;
+    size_t scanned = 0;
+    auto checkView = [&](const RecordView& view) {
+        ++scanned;
+        if (scanOk && !DataValidator::verifyChecksum(checksums, view)) scanOk = false;
+    };
+    
+    std::cout << "    Sequential scan..." << std::flush;
+    timer.start();
+    strategy->scanSequential(checkView);
+    timer.stop();
+    result.scanTime = timer.getElapsedSeconds();
+    result.seqReadTime = result.scanTime;
+    std::cout << " Done (" << result.scanTime << "s)" << std::endl;
+    
+    result.dataVerified = scanOk && scanned == checksums.size();
+    if (!result.dataVerified) {
+        std::cerr << "    WARNING: sequential scan verification failed!" << std::endl;
+    }
+    
+    result.numRandomReads = randomIndices.size();
+    if (cache) cache->resetStats();
+    std::cout << "    Random read..." << std::flush;
+    timer.start();
+    auto randRecords = strategy->readRandom(randomIndices);
+    timer.stop();
+    result.randReadTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.randReadTime << "s)" << std::endl;
+    
+    result.randReadLat = latencies.randRead.summary();
+    strategy->setLatencyRecorder(nullptr);
+    
+    if (!DataValidator::verifyChecksums(checksums, randRecords, randomIndices)) {
+        std::cerr << "    WARNING: random read verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+    
+    runPointLookups(strategy, randomIndices, result,
+                    [&](const RecordView& view) { return DataValidator::verifyChecksum(checksums, view); });
+    
+    scanOk = true;
+    scanned = 0;
+    std::cout << "    Random scan..." << std::flush;
+    timer.start();
+    strategy->scanRandom(randomIndices, checkView);
+    timer.stop();
+    result.randScanTime = timer.getElapsedSeconds();
+    std::cout << " Done (" << result.randScanTime << "s)" << std::endl;
+    
+    if (!scanOk || scanned != randomIndices.size()) {
+        std::cerr << "    WARNING: random scan verification failed!" << std::endl;
+        result.dataVerified = false;
+    }
+    
+    if (cache) {
+        BlockCache::Stats stats = cache->stats();
+        result.cacheEnabled = true;
+        result.cacheHits = stats.hits;
+        result.cacheMisses = stats.misses;
+        result.cacheEvictions = stats.evictions;
+    }
+    
+    FileHandleStats handles = strategy->getFileHandleStats();
+    result.fdOpens = handles.opens;
+    result.fdReuses = handles.reuses;
+    result.fdEvictions = handles.evictions;
+    
     strategy->cleanUp();
     return result;
 }
 
+// Random reads under each access pattern, issued in batches so the order
+// of the stream (temporal reuse, runs) still matters to a cache across
+// readRandom calls even though each call sorts its own batch.
+std::vector<WorkloadMetrics> runAccessPatterns(StorageStrategy* strategy, const std::vector<Record>& records,
+                                               const AccessPattern& pattern, size_t numReads, size_t batchSize) {
+    std::vector<WorkloadMetrics> results;
+    BlockCache* cache = strategy->getBlockCache();
+    std::string name = displayName(strategy);
+    
+    std::cout << "  Access patterns on " << name << "..." << std::flush;
+    strategy->write(records);
+    
+    BenchmarkTimer timer;
+    for (Distribution dist : AccessPattern::all()) {
+        auto indices = pattern.generate(dist, numReads, records.size());
+        
+        WorkloadMetrics result;
+        result.strategy = name;
+        result.workload = AccessPattern::name(dist);
+        result.reads = indices.size();
+        std::vector<int> sorted(indices);
+        std::sort(sorted.begin(), sorted.end());
+        result.distinctRecords = std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+        
+        // every pattern starts cold
+        if (cache) {
+            cache->clear();
+            cache->resetStats();
+        }
+        
+        result.dataVerified = true;
+        double elapsed = 0.0;
+        for (size_t begin = 0; begin < indices.size(); begin += batchSize) {
+            std::vector<int> batch(indices.begin() + begin,
+                                   indices.begin() + std::min(indices.size(), begin + batchSize));
+            timer.start();
+            auto batchRecords = strategy->readRandom(batch);
+            timer.stop();
+            elapsed += timer.getElapsedSeconds();
+            if (!DataValidator::verifySubset(records, batchRecords, batch)) result.dataVerified = false;
+        }
+        result.readTime = elapsed;
+        
+        if (cache) {
+            result.cacheEnabled = true;
+            result.cacheHitRate = cache->stats().hitRate();
+        }
+        if (!result.dataVerified) {
+            std::cerr << "\n    WARNING: " << result.workload << " read verification failed!" << std::endl;
+        }
+        results.push_back(result);
+    }
+    
+    strategy->cleanUp();
+    std::cout << " Done" << std::endl;
+    return results;
+}
+
+void printWorkloads(const std::vector<WorkloadMetrics>& results) {
+    if (results.empty()) return;
+    
+    std::cout << "ACCESS PATTERNS (" << results.front().reads << " random reads each)\n" << std::endl;
+    std::cout << std::left << std::setw(22) << "Strategy"
+              << std::setw(12) << "Pattern"
+              << std::right << std::setw(12) << "Distinct"
+              << std::setw(12) << "Time (s)"
+              << std::setw(14) << "Reads/s"
+              << std::setw(12) << "Hit Rate"
+              << std::setw(11) << "Verified" << std::endl;
+    std::cout << std::string(95, '-') << std::endl;
+    
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(22) << result.strategy
+                  << std::setw(12) << result.workload
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.distinctRecords
+                  << std::setw(12) << result.readTime
+                  << std::setw(14) << std::setprecision(0) << result.readsPerSecond()
+                  << std::setw(12) << std::setprecision(3);
+        if (result.cacheEnabled) {
+            std::cout << result.cacheHitRate;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(11) << (result.dataVerified ? "YES" : "NO") << std::endl;
+    }
+    
+    std::cout << "\n========================================\n" << std::endl;
+}
+
+// What the read scaling's writer puts in place of record `id` at `version`
+// (from 1): id and version, then the bytes of records[id % size], so a
+// reader can tell which version it got and check the rest.
+std::vector<char> versionedPayload(const std::vector<Record>& records, int id, uint32_t version) {
+    const auto& base = records[id % records.size()].data;
+    std::vector<char> data(8 + base.size());
+    std::memcpy(data.data(), &id, 4);
+    std::memcpy(data.data() + 4, &version, 4);
+    std::memcpy(data.data() + 8, base.data(), base.size());
+    return data;
+}
+
+// the version of `id` a read returned (0 for the original record), -1 if
+// it's no version the writer ever wrote
+int64_t payloadVersion(const std::vector<Record>& records, const Record& record) {
+    const auto& base = records[record.id % records.size()].data;
+    const auto& data = record.data;
+    if (static_cast<size_t>(record.id) < records.size() && data.size() == base.size())
+        return std::equal(data.begin(), data.end(), base.begin()) ? 0 : -1;
+    if (data.size() != base.size() + 8) return -1;
+    int id;
+    uint32_t version;
+    std::memcpy(&id, data.data(), 4);
+    std::memcpy(&version, data.data() + 4, 4);
+    if (id != record.id || version == 0 || !std::equal(data.begin() + 8, data.end(), base.begin())) return -1;
+    return version;
+}
+
+// One round of the read scaling: n reader threads on `strategy` for
+// `millis`, each with its own histogram and counter so the measuring doesn't
+// contend. With batch > 1 each thread asks readRandom for `batch` records at
+// a time instead of calling readOne, latency is still per record.
+//
+// With a writer, one more thread update()s random records and append()s new
+// ones meanwhile. It marks a version started before the call and committed
+// after it, so every read has to come back with a version between what was
+// committed when it began and what was started when it ended, and never one
+// older than the same reader already saw: the snapshot it read from was
+// current at some point during the call.
+ScalingMetrics runScalingRound(StorageStrategy* strategy, const std::vector<Record>& records,
+                               size_t millis, size_t n, unsigned int seed, size_t batch, bool writer) {
+    std::vector<std::unique_ptr<LatencyHistogram>> hists;
+    for (size_t t = 0; t < n; ++t) hists.push_back(std::make_unique<LatencyHistogram>());
+    std::vector<size_t> reads(n, 0);
+    std::vector<char> ok(n, 1);
+    std::vector<std::exception_ptr> errors(n + 1);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    
+    // the writer's bookkeeping, room for as many appended records again
+    size_t capacity = writer ? 2 * records.size() : 0;
+    std::vector<std::atomic<uint32_t>> started(capacity);
+    std::vector<std::atomic<uint32_t>> committed(capacity);
+    std::atomic<size_t> published{records.size()};
+    size_t writes = 0;
+    
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(seed + static_cast<unsigned int>(t));
+            LatencyHistogram& hist = *hists[t];
+            std::vector<uint32_t> seen(capacity, 0);
+            std::vector<uint32_t> low(batch);
+            size_t done = 0;
+            bool good = true;
+            ++ready;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            std::vector<int> ids(batch);
+            try {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    std::uniform_int_distribution<int> pick(0, static_cast<int>(published.load()) - 1);
+                    for (size_t i = 0; i < batch; ++i) {
+                        ids[i] = pick(rng);
+                        if (writer) low[i] = committed[ids[i]].load();
+                    }
+                    uint64_t start = OpClock::now();
+                    std::vector<Record> got;
+                    if (batch == 1) {
+                        got.push_back(strategy->readOne(ids[0]));
+                    } else {
+                        got = strategy->readRandom(ids);
+                    }
+                    uint64_t perRecord = OpClock::toNanos(OpClock::now() - start) / batch;
+                    for (size_t i = 0; i < batch; ++i) hist.record(perRecord);
+                    
+                    if (good && writer) {
+                        good = got.size() == batch;
+                        for (size_t i = 0; i < batch && good; ++i) {
+                            int64_t version = payloadVersion(records, got[i]);
+                            int id = ids[i];
+                            good = got[i].id == id && version >= low[i] && version >= seen[id] &&
+                                   version <= started[id].load();
+                            if (good) seen[id] = static_cast<uint32_t>(version);
+                        }
+                    } else if (good && done % 64 < batch) {
+                        // spot checks, comparing every record would be most of the work
+                        const Record& record = got.front();
+                        good = got.size() == batch && record.id == ids[0] &&
+                               DataValidator::verifyView(records, RecordView(record.id, record.data.data(),
+                                                                             record.data.size()));
+                    }
+                    done += batch;
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+            reads[t] = done;
+            ok[t] = good;
+        });
+    }
+    if (writer) {
+        threads.emplace_back([&] {
+            std::mt19937 rng(seed + 1000);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            try {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    // every 64th change is a batch of 16 new records
+                    size_t next = published.load();
+                    if (writes % 64 == 63 && next + 16 <= capacity) {
+                        std::vector<Record> batch;
+                        for (size_t i = 0; i < 16; ++i) {
+                            int id = static_cast<int>(next + i);
+                            started[id] = 1;
+                            batch.emplace_back(id, 0);
+                            batch.back().data = versionedPayload(records, id, 1);
+                        }
+                        strategy->append(batch);
+                        for (size_t i = 0; i < 16; ++i) committed[next + i] = 1;
+                        published = next + 16;
+                        writes += 16;
+                        continue;
+                    }
+                    int id = static_cast<int>(rng() % next);
+                    uint32_t version = started[id].load() + 1;
+                    started[id] = version;
+                    strategy->update(id, versionedPayload(records, id, version));
+                    committed[id] = version;
+                    ++writes;
+                }
+            } catch (...) {
+                errors[n] = std::current_exception();
+            }
+        });
+    }
+    
+    while (ready.load() < n) std::this_thread::yield();
+    BenchmarkTimer timer;
+    timer.start();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    timer.stop();
+    
+    ScalingMetrics result;
+    result.strategy = displayName(strategy);
+    result.threads = n;
+    result.writer = writer;
+    result.writes = writes;
+    result.readTime = timer.getElapsedSeconds();
+    result.dataVerified = true;
+    LatencyHistogram all;
+    for (size_t t = 0; t < n; ++t) {
+        result.reads += reads[t];
+        all.merge(*hists[t]);
+        result.threadLat.push_back(hists[t]->summary());
+        if (!ok[t]) result.dataVerified = false;
+    }
+    for (const auto& error : errors) {
+        if (!error) continue;
+        result.dataVerified = false;
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            std::cerr << "\n    WARNING: read scaling thread failed: " << e.what() << std::endl;
+        }
+    }
+    result.lat = all.summary();
+    if (!result.dataVerified) {
+        std::cerr << "\n    WARNING: read scaling verification failed with " << n << " threads"
+                  << (writer ? " and a writer!" : "!") << std::endl;
+    }
+    return result;
+}
+
+// runScalingRound from 1, 2, 4, ... up to maxThreads threads, all on the
+// same strategy, then maxThreads again next to a writer if it takes updates
+std::vector<ScalingMetrics> runReadScaling(StorageStrategy* strategy, const std::vector<Record>& records,
+                                           size_t millis, size_t maxThreads, unsigned int seed,
+                                           size_t batch = 1) {
+    std::vector<ScalingMetrics> results;
+    
+    std::cout << "  Read scaling on " << displayName(strategy) << "..." << std::flush;
+    strategy->write(records);
+    strategy->readOne(0);  // index loaded (and file mapped) before the clock runs
+    
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+    for (size_t n : counts) {
+        results.push_back(runScalingRound(strategy, records, millis, n, seed, batch, false));
+    }
+    if (strategy->supportsUpdates()) {
+        results.push_back(runScalingRound(strategy, records, millis, maxThreads, seed, batch, true));
+    }
+    
+    strategy->cleanUp();
+    std::cout << " Done" << std::endl;
+    return results;
+}
+
+void printScaling(const std::vector<ScalingMetrics>& results, size_t millis) {
+    if (results.empty()) return;
+    
+    std::cout << "READ SCALING (random point reads from N threads on one instance, "
+              << millis << "ms each, N+w next to a writer)\n" << std::endl;
+    std::cout << std::left << std::setw(22) << "Strategy"
+              << std::right << std::setw(8) << "Threads"
+              << std::setw(14) << "Reads/s"
+              << std::setw(10) << "Speedup"
+              << std::setw(11) << "p50 (us)"
+              << std::setw(11) << "p99 (us)"
+              << std::setw(12) << "p99.9 (us)"
+              << std::setw(13) << "Worst p99"
+              << std::setw(11) << "Verified"
+              << std::setw(11) << "Writes/s" << std::endl;
+    std::cout << std::string(123, '-') << std::endl;
+    
+    double base = 0.0;  // one thread on the same strategy
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        if (i == 0 || result.strategy != results[i - 1].strategy) base = result.readsPerSecond();
+        std::string threads = std::to_string(result.threads) + (result.writer ? "+w" : "");
+        std::cout << std::left << std::setw(22) << result.strategy
+                  << std::right << std::setw(8) << threads
+                  << std::fixed << std::setprecision(0)
+                  << std::setw(14) << result.readsPerSecond()
+                  << std::setprecision(2)
+                  << std::setw(9) << (base > 0.0 ? result.readsPerSecond() / base : 0.0) << "x"
+                  << std::setw(11) << result.lat.p50
+                  << std::setw(11) << result.lat.p99
+                  << std::setw(12) << result.lat.p999
+                  << std::setw(13) << result.worstThreadP99()
+                  << std::setw(11) << (result.dataVerified ? "YES" : "NO")
+                  << std::setprecision(0) << std::setw(11);
+        if (result.writer) {
+            std::cout << result.writesPerSecond() << std::endl;
+        } else {
+            std::cout << "-" << std::endl;
+        }
+    }
+    
+    std::cout << "\n========================================\n" << std::endl;
+}
+
 void printResults(const std::vector<BenchmarkMetrics>& results) {
     std::cout << "\n========================================" << std::endl;
     std::cout << "BENCHMARK RESULTS" << std::endl;
     std::cout << "========================================\n" << std::endl;
     
     
-    std::cout << std::left << std::setw(15) << "Strategy"
+    std::cout << std::left << std::setw(22) << "Strategy"
               << std::right << std::setw(12) << "Write (s)"
               << std::setw(15) << "Write (MB/s)"
               << std::setw(12) << "SeqRead (s)"
               << std::setw(15) << "SeqRead (MB/s)"
               << std::setw(12) << "RandRead (s)"
               << std::setw(13) << "Verified" << std::endl;
-    std::cout << std::string(94, '-') << std::endl;
+    std::cout << std::string(101, '-') << std::endl;
     
     for (const auto& result : results) {
-        std::cout << std::left << std::setw(15) << result.strategy
+        std::cout << std::left << std::setw(22) << result.strategy
                   << std::right << std::fixed << std::setprecision(3)
                   << std::setw(12) << result.writeTime
                   << std::setw(15) << result.writeThroughput()
@@ -100,60 +869,387 @@ void printResults(const std::vector<BenchmarkMetrics>& results) {
                   << std::setw(13) << (result.dataVerified ? "YES" : "NO") << std::endl;
     }
     
-    std::cout << "\n" << std::left << std::setw(15) << "Strategy"
+    std::cout << "\n" << std::left << std::setw(22) << "Strategy"
               << std::right << std::setw(15) << "Disk Space"
               << std::setw(15) << "Num Files"
-              << std::setw(18) << "Bytes/Record" << std::endl;
-    std::cout << std::string(63, '-') << std::endl;
+              << std::setw(18) << "Bytes/Record"
+              << std::setw(15) << "Padding (KB)"
+              << std::setw(10) << "Ratio" << std::endl;
+    std::cout << std::string(95, '-') << std::endl;
     
     for (const auto& result : results) {
-        double bytesPerRecord = static_cast<double>(result.diskSpaceUsed) / 100000.0;
-        std::cout << std::left << std::setw(15) << result.strategy
+        double bytesPerRecord = static_cast<double>(result.diskSpaceUsed) / std::max<size_t>(result.numRecords, 1);
+        std::cout << std::left << std::setw(22) << result.strategy
                   << std::right << std::fixed << std::setprecision(2)
                   << std::setw(15) << (result.diskSpaceUsed / 1024.0 / 1024.0) << " MB"
                   << std::setw(12) << result.numFiles
-                  << std::setw(18) << bytesPerRecord << std::endl;
+                  << std::setw(18) << bytesPerRecord
+                  << std::setw(15) << (result.paddingBytes / 1024.0)
+                  << std::setw(10) << result.compressionRatio() << std::endl;
+    }
+    
+    std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+              << std::right << std::setw(12) << "Scan (s)"
+              << std::setw(15) << "Scan (MB/s)"
+              << std::setw(15) << "RandScan (s)" << std::endl;
+    std::cout << std::string(64, '-') << std::endl;
+    
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(22) << result.strategy
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.scanTime
+                  << std::setw(15) << result.scanThroughput()
+                  << std::setw(15) << result.randScanTime << std::endl;
+    }
+    
+    // per-record latency percentiles, one row per strategy and operation
+    std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+              << std::setw(10) << "Op"
+              << std::right << std::setw(11) << "p50 (us)"
+              << std::setw(11) << "p90 (us)"
+              << std::setw(11) << "p99 (us)"
+              << std::setw(12) << "p99.9 (us)"
+              << std::setw(12) << "Max (us)" << std::endl;
+    std::cout << std::string(89, '-') << std::endl;
+    
+    for (const auto& result : results) {
+        const std::pair<const char*, const LatencySummary*> ops[] = {
+            {"write", &result.writeLat}, {"seqread", &result.seqReadLat}, {"randread", &result.randReadLat},
+            {"readone", &result.pointReadLat}, {"update", &result.updateLat}};
+        for (const auto& [op, lat] : ops) {
+            if (lat->count == 0) continue;  // strategy doesn't time records
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::setw(10) << op
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(11) << lat->p50
+                      << std::setw(11) << lat->p90
+                      << std::setw(11) << lat->p99
+                      << std::setw(12) << lat->p999
+                      << std::setw(12) << lat->max << std::endl;
+        }
+    }
+    
+    bool anyBatch = std::any_of(results.begin(), results.end(),
+                                [](const BenchmarkMetrics& r) { return r.seqReadBatchTime > 0; });
+    if (anyBatch) {
+        std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+                  << std::right << std::setw(15) << "SeqRead (s)"
+                  << std::setw(15) << "Arena (s)"
+                  << std::setw(12) << "Speedup" << std::endl;
+        std::cout << std::string(64, '-') << std::endl;
+        
+        for (const auto& result : results) {
+            if (result.seqReadBatchTime <= 0) continue;
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(15) << result.seqReadTime
+                      << std::setw(15) << result.seqReadBatchTime
+                      << std::setw(11) << result.seqReadTime / result.seqReadBatchTime << "x" << std::endl;
+        }
+    }
+    
+    bool anyUpdates = std::any_of(results.begin(), results.end(),
+                                  [](const BenchmarkMetrics& r) { return r.updateLat.count > 0; });
+    if (anyUpdates) {
+        std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+                  << std::right << std::setw(15) << "Dead (KB)"
+                  << std::setw(18) << "Reclaimed (KB)"
+                  << std::setw(15) << "Compact (s)"
+                  << std::setw(15) << "Write (s)"
+                  << std::setw(15) << "Append (s)" << std::endl;
+        std::cout << std::string(100, '-') << std::endl;
+        
+        for (const auto& result : results) {
+            if (result.updateLat.count == 0) continue;
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(15) << result.deadBytes / 1024.0;
+            // no compact() to run, nothing it could have reclaimed
+            if (result.compacted) {
+                std::cout << std::setw(18) << result.reclaimedBytes / 1024.0
+                          << std::setprecision(3) << std::setw(15) << result.compactTime;
+            } else {
+                std::cout << std::setw(18) << "-" << std::setw(15) << "-";
+            }
+            std::cout << std::setprecision(3)
+                      << std::setw(15) << result.writeTime
+                      << std::setw(15) << result.appendTime << std::endl;
+        }
+    }
+    
+    bool anySyncs = std::any_of(results.begin(), results.end(),
+                                [](const BenchmarkMetrics& r) { return r.syncCount > 0; });
+    if (anySyncs) {
+        std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+                  << std::right << std::setw(12) << "Syncs"
+                  << std::setw(18) << "Avg Commit (ms)"
+                  << std::setw(18) << "Max Commit (ms)" << std::endl;
+        std::cout << std::string(70, '-') << std::endl;
+        
+        for (const auto& result : results) {
+            if (result.syncCount == 0) continue;
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(12) << result.syncCount
+                      << std::setw(18) << result.avgCommitLatency * 1000.0
+                      << std::setw(18) << result.maxCommitLatency * 1000.0 << std::endl;
+        }
+    }
+    
+    bool anyCache = std::any_of(results.begin(), results.end(),
+                                [](const BenchmarkMetrics& r) { return r.cacheEnabled; });
+    if (anyCache) {
+        std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+                  << std::right << std::setw(12) << "Hits"
+                  << std::setw(12) << "Misses"
+                  << std::setw(12) << "Evictions"
+                  << std::setw(12) << "Hit Rate" << std::endl;
+        std::cout << std::string(70, '-') << std::endl;
+        
+        for (const auto& result : results) {
+            if (!result.cacheEnabled) continue;
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(12) << result.cacheHits
+                      << std::setw(12) << result.cacheMisses
+                      << std::setw(12) << result.cacheEvictions
+                      << std::setw(12) << result.cacheHitRate() << std::endl;
+        }
+    }
+    
+    bool anyHandles = std::any_of(results.begin(), results.end(),
+                                  [](const BenchmarkMetrics& r) { return r.fdOpens > 0; });
+    if (anyHandles) {
+        std::cout << "\n" << std::left << std::setw(22) << "Strategy"
+                  << std::right << std::setw(12) << "Opens"
+                  << std::setw(12) << "Reused"
+                  << std::setw(12) << "Evictions" << std::endl;
+        std::cout << std::string(58, '-') << std::endl;
+        
+        for (const auto& result : results) {
+            if (result.fdOpens == 0) continue;
+            std::cout << std::left << std::setw(22) << result.strategy
+                      << std::right
+                      << std::setw(12) << result.fdOpens
+                      << std::setw(12) << result.fdReuses
+                      << std::setw(12) << result.fdEvictions << std::endl;
+        }
     }
     
     std::cout << "\n========================================\n" << std::endl;
 }
 
-int main() {
-    const size_t NUM_RECORDS = 100000;
-    const unsigned int SEED = 24;
+// spread across repetitions, only printed when there's more than one
+void printRepetitions(const std::vector<StrategyRuns>& results) {
+    if (results.empty() || results.front().runs.size() < 2) return;
+    
+    std::cout << "REPETITIONS (" << results.front().runs.size() << " runs, mean / stddev / 95% CI)\n" << std::endl;
+    std::cout << std::left << std::setw(22) << "Strategy"
+              << std::setw(10) << "Phase"
+              << std::right << std::setw(12) << "Mean (s)"
+              << std::setw(12) << "Stddev"
+              << std::setw(24) << "CI95 (s)" << std::endl;
+    std::cout << std::string(80, '-') << std::endl;
+    
+    for (const auto& r : results) {
+        const std::pair<const char*, SampleStats> phases[] = {
+            {"write",    r.stats([](const BenchmarkMetrics& m) { return m.writeTime; })},
+            {"seqread",  r.stats([](const BenchmarkMetrics& m) { return m.seqReadTime; })},
+            {"randread", r.stats([](const BenchmarkMetrics& m) { return m.randReadTime; })},
+            {"scan",     r.stats([](const BenchmarkMetrics& m) { return m.scanTime; })}};
+        for (const auto& [phase, s] : phases) {
+            std::ostringstream ci;
+            ci << std::fixed << std::setprecision(4) << "[" << s.ciLow << ", " << s.ciHigh << "]";
+            std::cout << std::left << std::setw(22) << r.strategy
+                      << std::setw(10) << phase
+                      << std::right << std::fixed << std::setprecision(4)
+                      << std::setw(12) << s.mean
+                      << std::setw(12) << s.stddev
+                      << std::setw(24) << ci.str() << std::endl;
+        }
+    }
+    
+    std::cout << "\n========================================\n" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig config;
+    try {
+        config = BenchmarkConfig::parse(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << "\n" << std::endl;
+        BenchmarkConfig::printUsage(std::cerr, argv[0]);
+        return 1;
+    }
+    if (config.showHelp) {
+        BenchmarkConfig::printUsage(std::cout, argv[0]);
+        return 0;
+    }
+    
+    // one cache shared by the +cache variants and the pattern sweep
+    // (each strategy cleans up its own files)
+    auto blockCache = std::make_shared<BlockCache>(config.cacheMB * 1024 * 1024);
+    
+    std::vector<StrategySpec> specs;
+    try {
+        specs = StrategyFactory::select(config, blockCache);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (config.listStrategies) {
+        std::string last;
+        for (const auto& spec : specs) {
+            if (spec.key == last) continue;  // sharded sweep shows up once
+            last = spec.key;
+            std::cout << std::left << std::setw(22) << spec.key << spec.description << std::endl;
+        }
+        return 0;
+    }
     
     std::cout << "DUNE Fine-Grained Storage Benchmark" << std::endl;
     std::cout << "====================================" << std::endl;
-    std::cout << "Generating " << NUM_RECORDS << " records..." << std::endl;
-    
-    DataGenerator generator(SEED);
-    auto records = generator.generateRecords(NUM_RECORDS);
+    std::cout << "crc32c: " << (crc32cHardware() ? "sse4.2" : "software")
+              << (config.checksums ? "" : " (index checksums off)") << std::endl;
     
+    // in streaming mode only the expected checksums stay in memory
+    std::vector<Record> records;
+    std::vector<uint32_t> checksums;
+    StreamingGenerator streamer(config.seed, config.compressibility,
+                                config.minRecordSize, config.maxRecordSize, config.sizeDist);
     size_t totalDataSize = 0;
-    for (const auto& r : records) totalDataSize += r.data.size();
+    BenchmarkTimer generationTimer;
+    generationTimer.start();
+    
+    if (config.streaming) {
+        std::cout << "Checksumming " << config.numRecords << " streamed records..." << std::endl;
+        checksums = streamer.checksums(config.numRecords, config.threads);
+        for (size_t i = 0; i < config.numRecords; ++i) totalDataSize += streamer.sizeOf(static_cast<int>(i));
+    } else {
+        std::cout << "Generating " << config.numRecords << " records..." << std::endl;
+        if (config.legacyGenerator) {
+            DataGenerator generator(config.seed, config.compressibility,
+                                    config.minRecordSize, config.maxRecordSize, config.sizeDist);
+            records = generator.generateRecords(config.numRecords);
+        } else {
+            records = streamer.generateRecords(config.numRecords, config.threads);
+        }
+        for (const auto& r : records) totalDataSize += r.data.size();
+    }
+    generationTimer.stop();
     
     std::cout << "Generation complete (" << std::fixed << std::setprecision(2)
-              << (totalDataSize / 1024.0 / 1024.0)
-              << " MB). Starting benchmarks...\n" << std::endl;
+              << (totalDataSize / 1024.0 / 1024.0) << " MB in "
+              << generationTimer.getElapsedSeconds() << "s). Starting benchmarks...\n" << std::endl;
+    if (!config.streaming) printAllocationCost(records);
     
-    std::vector<BenchmarkMetrics> results;
+    AccessPattern pattern(config.seed);
+    auto randomIndices = pattern.generate(Distribution::Uniform, config.randomReads, config.numRecords);
     
-    {
-        SingleFileStrategy strategy("data_single");
-        results.push_back(runBenchmark(&strategy, records, totalDataSize));
+    std::vector<StrategyRuns> results;
+    for (const auto& spec : specs) {
+        StrategyRuns runs;
+        for (size_t rep = 0; rep < config.repetitions; ++rep) {
+            auto strategy = spec.make();
+            if (!config.checksums) strategy->setChecksums(false);
+            strategy->setReadCoalescing(config.coalesce, config.coalesceGap);
+            if (config.streaming && !strategy->supportsStreaming()) {
+                std::cout << "  Skipping " << strategy->getName()
+                          << " (needs every record in memory to write)" << std::endl;
+                break;
+            }
+            if (config.repetitions > 1) {
+                std::cout << "  [" << spec.key << " rep " << rep + 1 << "/" << config.repetitions << "]" << std::endl;
+            }
+            runs.runs.push_back(config.streaming
+                ? runStreamingBenchmark(strategy.get(), streamer, checksums, totalDataSize, randomIndices)
+                : runBenchmark(strategy.get(), records, totalDataSize, randomIndices, config.autoCompact));
+        }
+        if (runs.runs.empty()) continue;
+        runs.strategy = runs.runs.front().strategy;
+        results.push_back(std::move(runs));
     }
     
-    {
-        ChunkedFileStrategy strategy("data_chunked", 1000);
-        results.push_back(runBenchmark(&strategy, records, totalDataSize));
+    // tables show the first repetition, verified only if every rep was
+    std::vector<BenchmarkMetrics> firstRuns;
+    for (const auto& r : results) {
+        firstRuns.push_back(r.runs.front());
+        firstRuns.back().dataVerified = r.allVerified();
     }
+    printResults(firstRuns);
+    printRepetitions(results);
     
-    {
-        IndividualFileStrategy strategy("data_individual");
-        results.push_back(runBenchmark(&strategy, records, totalDataSize));
+    // how much the skew matters, with and without a cache in front
+    std::vector<WorkloadMetrics> workloads;
+    if (config.patternReads > 0 && config.streaming) {
+        std::cout << "Access pattern sweep skipped in --stream mode\n" << std::endl;
+    } else if (config.patternReads > 0) {
+        {
+            SingleFileStrategy strategy("data_single");
+            strategy.setReadCoalescing(config.coalesce, config.coalesceGap);
+            auto r = runAccessPatterns(&strategy, records, pattern, config.patternReads, config.patternBatch);
+            workloads.insert(workloads.end(), r.begin(), r.end());
+            
+            strategy.setBlockCache(blockCache);
+            r = runAccessPatterns(&strategy, records, pattern, config.patternReads, config.patternBatch);
+            workloads.insert(workloads.end(), r.begin(), r.end());
+        }
+        
+        {
+            ChunkedFileStrategy strategy("data_chunked", config.recordsPerChunk);
+            strategy.setReadCoalescing(config.coalesce, config.coalesceGap);
+            strategy.setBlockCache(blockCache);
+            auto r = runAccessPatterns(&strategy, records, pattern, config.patternReads, config.patternBatch);
+            workloads.insert(workloads.end(), r.begin(), r.end());
+        }
+        printWorkloads(workloads);
     }
     
-    printResults(results);
+    // how point reads hold up with more clients: one fd vs. many chunk files
+    std::vector<ScalingMetrics> scaling;
+    if (config.scalingMillis > 0 && config.streaming) {
+        std::cout << "Read scaling sweep skipped in --stream mode\n" << std::endl;
+    } else if (config.scalingMillis > 0) {
+        size_t maxThreads = config.threads ? config.threads
+                                           : std::max(1u, std::thread::hardware_concurrency());
+        {
+            SingleFileStrategy strategy("data_single");
+            auto r = runReadScaling(&strategy, records, config.scalingMillis, maxThreads, config.seed);
+            scaling.insert(scaling.end(), r.begin(), r.end());
+        }
+        {
+            SingleFileStrategy strategy("data_single", IoMode::Mmap);
+            auto r = runReadScaling(&strategy, records, config.scalingMillis, maxThreads, config.seed);
+            scaling.insert(scaling.end(), r.begin(), r.end());
+        }
+        {
+            ChunkedFileStrategy strategy("data_chunked", config.recordsPerChunk);
+            auto r = runReadScaling(&strategy, records, config.scalingMillis, maxThreads, config.seed);
+            scaling.insert(scaling.end(), r.begin(), r.end());
+        }
+        {
+            // every reader fans its chunks out over the one shared pool
+            ChunkedFileStrategy strategy("data_chunked", config.recordsPerChunk,
+                                         std::max<size_t>(2, maxThreads));
+            auto r = runReadScaling(&strategy, records, config.scalingMillis, maxThreads, config.seed, 64);
+            scaling.insert(scaling.end(), r.begin(), r.end());
+        }
+        printScaling(scaling, config.scalingMillis);
+    }
+    
+    try {
+        if (!config.jsonPath.empty()) {
+            ResultWriter::writeJson(config.jsonPath, config, results, workloads, scaling);
+            std::cout << "Wrote " << config.jsonPath << std::endl;
+        }
+        if (!config.csvPath.empty()) {
+            ResultWriter::writeCsv(config.csvPath, results);
+            std::cout << "Wrote " << config.csvPath << std::endl;
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
     
     std::cout << "Benchmark complete!" << std::endl;
     